@@ -21,7 +21,13 @@ var connection = (function()
     this_.connect = function(uri)
     {
         websocket = new WebSocket(uri);
-        websocket.onopen = function(evt) { log("CONNECTED"); };
+        websocket.binaryType = 'arraybuffer';
+        websocket.onopen = function(evt)
+        {
+            log("CONNECTED");
+            if (this_.binaryProtocol)
+                send('proto binary');
+        };
         websocket.onclose = function(evt)
         {
             log_error("DISCONNECTED");
@@ -56,6 +62,7 @@ var connection = (function()
     var messageHandlers =
     {
         map: function(pkt) { this_.ui.setMap(pkt); },
+        map_chunk: function(pkt) { this_.ui.setMapChunk(pkt); },
         init: function(pkt)
         {
             pkt.state = PlayerState.Idle;
@@ -95,12 +102,106 @@ var connection = (function()
         hp_change: function(pkt) { this_.ui.healthChange(pkt); },
     };
 
+    var handlePacket = function(pkt)
+    {
+        if ('type' in pkt && pkt.type in messageHandlers)
+            messageHandlers[pkt.type](pkt);
+        else
+            log_error('unknown packet type');
+    };
+
+    // Binary protocol: each record is a PacketType tag and the packet's fields,
+    // see src/server/BinaryPacketBuilder.hpp.
+    var binaryPackets =
+    [
+        null,
+        function(r) { return {type: 'map', cx: r.i32(), cy: r.i32()}; },
+        function(r)
+        {
+            var pkt = {type: 'map_chunk', x: r.i32(), y: r.i32(), cx: r.u16()};
+            var count = pkt.cx * r.u16();
+            var bits = r.bytes((count + 7) >> 3);
+            var cells = '';
+            for (var i = 0; i != count; i++)
+                cells += (bits[i >> 3] >> (i & 7)) & 1 ? 'W' : '.';
+            pkt.cells = cells;
+            return pkt;
+        },
+        function(r) { return {type: 'init', id: r.varint(), x: r.i32(), y: r.i32(), hp: r.i32(), name: r.str()}; },
+        function(r)
+        {
+            return {type: 'see_player', id: r.varint(), dir: r.u8(), state: r.u8(), x: r.i32(), y: r.i32(), name: r.str()};
+        },
+        function(r) { return {type: 'disconnect'}; },
+        function(r) { return {type: 'see_disappear', id: r.varint()}; },
+        function(r) { return {type: 'see_begin_move', id: r.varint(), dir: r.u8()}; },
+        function(r) { return {type: 'see_cross_cell', id: r.varint()}; },
+        function(r) { return {type: 'see_stop', id: r.varint()}; },
+        function(r) { return {type: 'see_cast', id: r.varint(), spell: r.u8()}; },
+        function(r) { return {type: 'see_end_cast', id: r.varint()}; },
+        function(r) { return {type: 'see_effect', x: r.i32(), y: r.i32(), effect: r.u8()}; },
+        function(r) { return {type: 'hp_change', hp: r.i32()}; },
+    ];
+
+    var BinaryReader = function(buffer)
+    {
+        var view = new DataView(buffer);
+        var pos = 0;
+        var utf8 = new TextDecoder('utf-8');
+
+        this.atEnd = function() { return pos == view.byteLength; };
+        this.u8 = function() { return view.getUint8(pos++); };
+        this.u16 = function() { var v = view.getUint16(pos, true); pos += 2; return v; };
+        this.i32 = function() { var v = view.getInt32(pos, true); pos += 4; return v; };
+        this.bytes = function(n) { var v = new Uint8Array(buffer, pos, n); pos += n; return v; };
+        this.str = function() { return utf8.decode(this.bytes(this.varint())); };
+
+        // ids use up to 53 bits, so no 32-bit bitwise ops here
+        this.varint = function()
+        {
+            var value = 0, scale = 1, b;
+            do
+            {
+                b = this.u8();
+                value += (b & 0x7f) * scale;
+                scale *= 128;
+            } while (b & 0x80);
+            return value;
+        };
+    };
+
+    var onBinaryMessage = function(buffer)
+    {
+        log('RECV: ' + buffer.byteLength + ' bytes');
+        var reader = new BinaryReader(buffer);
+        try
+        {
+            while (!reader.atEnd())
+            {
+                var decode = binaryPackets[reader.u8()];
+                if (!decode) { log_error('unknown packet type'); return; }
+                handlePacket(decode(reader));
+            }
+        }
+        catch (e)
+        {
+            log_error('invalid packet format');
+        }
+    };
+
+    // the server sends all packets of a tick as one array, or as one binary frame;
+    // binary is opt-in, for servers built with WS_BINARY_FRAMES
+    this_.binaryProtocol = false;
+
     this_.onMessage = function(msg)
     {
+        if (msg instanceof ArrayBuffer)
+            return onBinaryMessage(msg);
+
         log('RECV: ' + msg);
         try
         {
-            var pkt = JSON.parse(msg);
+            var frame = JSON.parse(msg);
         }
         catch (e)
         {
@@ -108,10 +209,10 @@ var connection = (function()
             return;
         }
 
-        if ('type' in pkt && pkt.type in messageHandlers)
-            messageHandlers[pkt.type](pkt);
+        if (Array.isArray(frame))
+            frame.forEach(handlePacket);
         else
-            log_error('unknown packet type');
+            handlePacket(frame);
     };
 
     this_.requestMove = function(dirStr)
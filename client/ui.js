@@ -4,9 +4,72 @@ var ui = (function()
 
     var worldCX = 8, worldCY = 8;
 
+    // The table covers only the map chunks received so far: the rectangle
+    // [viewX, viewX + viewCX) x [viewY, viewY + viewCY) of world cells.
+    var viewX = 0, viewY = 0, viewCX = 0, viewCY = 0;
+
+    var cellAt = function(x, y)
+    {
+        if (x < viewX || y < viewY || x >= viewX + viewCX || y >= viewY + viewCY)
+            return $();
+        return $('#view tr').eq(y - viewY).children().eq(x - viewX);
+    };
+
+    // cells outside the received area are placed off the view
     var cellOffset = function(x, y)
     {
-        return $('#view tr:eq(' + y + ') td:eq(' + x + ')').offset();
+        return cellAt(x, y).offset() || {left: -1000, top: -1000};
+    };
+
+    var newRow = function(cellsCount)
+    {
+        var row = $('<tr>');
+        for (var i = 0; i != cellsCount; i++)
+            row.append($('<td>'));
+        return row;
+    };
+
+    // extends the table to cover [x0, x1) x [y0, y1)
+    var growView = function(x0, y0, x1, y1)
+    {
+        if (viewCX == 0)
+        {
+            viewX = x0;
+            viewY = y0;
+        }
+
+        var minX = Math.min(viewX, x0), minY = Math.min(viewY, y0);
+        var maxX = Math.max(viewX + viewCX, x1), maxY = Math.max(viewY + viewCY, y1);
+        if (minX == viewX && minY == viewY && maxX == viewX + viewCX && maxY == viewY + viewCY)
+            return;
+
+        var view = $('#view');
+        var left = viewX - minX, right = maxX - (viewX + viewCX);
+        $('#view tr').each(function()
+        {
+            var tr = $(this);
+            for (var i = 0; i != left; i++)
+                tr.prepend($('<td>'));
+            for (var i = 0; i != right; i++)
+                tr.append($('<td>'));
+        });
+
+        for (var y = viewY; y != minY; y--)
+            view.prepend(newRow(maxX - minX));
+        for (var y = viewY + viewCY; y != maxY; y++)
+            view.append(newRow(maxX - minX));
+
+        viewX = minX;
+        viewY = minY;
+        viewCX = maxX - minX;
+        viewCY = maxY - minY;
+
+        // the cells have moved on the page
+        $('#players>div').each(function()
+        {
+            var player = $(this);
+            this_.setPos(player, {x: +player.attr('x'), y: +player.attr('y')});
+        });
     };
 
     this_.log = function(text, level)
@@ -65,37 +128,40 @@ var ui = (function()
             return Math.abs(x - info.x) + Math.abs(y - info.y);
         };
 
-        for (var y = 0; y != worldCY; y++)
+        $('#view tr').each(function(row)
         {
-            var tr = $('#view tr').eq(y);
-            for (var x = 0; x != worldCY; x++)
+            $(this).children().each(function(col)
             {
-                $('td', tr).eq(x).toggleClass('v', distance(x, y) <= 2);
-            }
-        }
+                $(this).toggleClass('v', distance(viewX + col, viewY + row) <= 2);
+            });
+        });
     };
 
+    // the table is built as map chunks arrive, see growView()
     this_.setMap = function(info)
     {
-        var cx = info.cx;
-        var cy = info.cells.length / cx;
-        var view = $('#view');
-        view.empty();
-        
+        worldCX = info.cx;
+        worldCY = info.cy;
+        viewX = viewY = viewCX = viewCY = 0;
+        $('#view').empty();
+    };
+
+    this_.setMapChunk = function(info)
+    {
+        var cy = info.cells.length / info.cx;
+        growView(info.x, info.y, info.x + info.cx, info.y + cy);
+
         var idx = 0;
         for (var y = 0; y != cy; y++)
         {
-            var row = $('<tr>');
-            for (var x = 0; x != cx; x++, idx++)
+            var tr = $('#view tr').eq(info.y + y - viewY);
+            for (var x = 0; x != info.cx; x++, idx++)
             {
-                var cell = $('<td>');
                 switch (info.cells[idx])
                 {
-                case 'W': cell.addClass('wall'); break;
+                case 'W': $('td', tr).eq(info.x + x - viewX).addClass('wall'); break;
                 }
-                row.append(cell);
             }
-            view.append(row);
         }
     };
     
@@ -116,11 +182,13 @@ var ui = (function()
     this_.getTargetPos = function()
     {
         var td = $('#view td.target');
-        var x = td.index();
-        var y = td.closest('tr').index();
+        var x = viewX + td.index();
+        var y = viewY + td.closest('tr').index();
         return x + ' ' + y;
     };
     
+    this_.cellAt = cellAt;
+
     this_.setTargetCell = function(td)
     {
         $('#view td.target').removeClass('target');
@@ -179,7 +247,7 @@ $(document).ready(function()
 
     $("#players").on('click', 'div', function(e)
     {
-        ui.setTargetCell($('#view tr:eq(' + $(this).attr('y') + ') td:eq(' + $(this).attr('x') + ')'));
+        ui.setTargetCell(ui.cellAt(+$(this).attr('x'), +$(this).attr('y')));
     });
     
     ui.log('initialization finished');
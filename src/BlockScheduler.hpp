@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "build_config.hpp"
+#include "types.hpp"
+#include "WorkerPool.hpp"
+
+struct alignas(64) WorkerStats
+{
+    std::uint64_t m_items{0};
+    std::uint64_t m_blocks{0};
+    std::uint64_t m_steals{0};
+    std::uint64_t m_busyNs{0};
+    std::uint64_t m_wallNs{0};  // time of the phases this worker took part in
+
+    double utilisation() const { return m_wallNs ? double(m_busyNs) / m_wallNs : 0.0; }
+};
+
+using WorkerStatsArray = std::array<WorkerStats, MaxThreads>;
+
+// Splits [0, n) into one contiguous range per worker. A worker takes blocks
+// from the front of its own range and, when it runs dry, steals blocks from
+// the back of the other ranges. Block size adapts to n and threads count.
+class BlockScheduler
+{
+public:
+    static unsigned blockSize(unsigned n, unsigned threadsCount)
+    {
+        auto size = n / (threadsCount * BlocksPerWorker);
+        return std::min<unsigned>(std::max<unsigned>(size, MinThreadBlockSize), ThreadBlockSize);
+    }
+
+    // calls `f(base, count, threadIdx)` for every block
+    template<typename F>
+    void run(WorkerPool& pool, unsigned n, F&& f)
+    {
+        auto threadsCount = pool.threadsCount();
+        auto bs = blockSize(n, threadsCount);
+
+        for (auto threadIdx = 0u; threadIdx != threadsCount; ++threadIdx)
+        {
+            auto first = static_cast<std::uint64_t>(n) * threadIdx / threadsCount;
+            auto last = static_cast<std::uint64_t>(n) * (threadIdx + 1) / threadsCount;
+            m_ranges[threadIdx].m_bounds.store(packRange(unsigned(first), unsigned(last)), std::memory_order_relaxed);
+        }
+
+        auto phaseStart = clock::now();
+
+        pool.run([&](ThrdIdx threadIdx)
+        {
+            auto&& stats = m_stats[threadIdx];
+            auto start = clock::now();
+
+            unsigned base, count;
+            while (popFront(m_ranges[threadIdx], bs, base, count))
+            {
+                f(base, count, threadIdx);
+                ++stats.m_blocks;
+                stats.m_items += count;
+            }
+
+            for (auto i = 1u; i != threadsCount; ++i)
+            {
+                auto&& victim = m_ranges[(threadIdx + i) % threadsCount];
+                while (popBack(victim, bs, base, count))
+                {
+                    f(base, count, threadIdx);
+                    ++stats.m_blocks;
+                    ++stats.m_steals;
+                    stats.m_items += count;
+                }
+            }
+
+            stats.m_busyNs += elapsedNs(start);
+        });
+
+        auto wallNs = elapsedNs(phaseStart);
+        for (auto threadIdx = 0u; threadIdx != threadsCount; ++threadIdx)
+            m_stats[threadIdx].m_wallNs += wallNs;
+    }
+
+    const WorkerStatsArray& stats() const { return m_stats; }
+    void resetStats() { m_stats = WorkerStatsArray{}; }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    static const auto BlocksPerWorker = 8u;
+
+    struct alignas(64) Range
+    {
+        std::atomic<std::uint64_t> m_bounds{0}; // front in low 32 bits, back in high 32 bits
+    };
+
+    static std::uint64_t packRange(unsigned front, unsigned back)
+    {
+        return static_cast<std::uint64_t>(back) << 32 | front;
+    }
+
+    static bool popFront(Range& r, unsigned bs, unsigned& base, unsigned& count)
+    {
+        auto bounds = r.m_bounds.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto front = static_cast<unsigned>(bounds), back = static_cast<unsigned>(bounds >> 32);
+            if (front >= back)
+                return false;
+
+            count = std::min(bs, back - front);
+            if (r.m_bounds.compare_exchange_weak(bounds, packRange(front + count, back)))
+            {
+                base = front;
+                return true;
+            }
+        }
+    }
+
+    static bool popBack(Range& r, unsigned bs, unsigned& base, unsigned& count)
+    {
+        auto bounds = r.m_bounds.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto front = static_cast<unsigned>(bounds), back = static_cast<unsigned>(bounds >> 32);
+            if (front >= back)
+                return false;
+
+            count = std::min(bs, back - front);
+            if (r.m_bounds.compare_exchange_weak(bounds, packRange(front, back - count)))
+            {
+                base = back - count;
+                return true;
+            }
+        }
+    }
+
+    static std::uint64_t elapsedNs(clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+    }
+
+    std::array<Range, MaxThreads> m_ranges;
+    WorkerStatsArray m_stats;
+};
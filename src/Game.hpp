@@ -4,7 +4,6 @@
 #include <algorithm>
 #include <atomic>
 #include <deque>
-#include <functional>
 #include <list>
 #include <memory>
 #include <numeric>
@@ -12,6 +11,7 @@
 #include <unordered_map>
 
 #include "GameCfg.hpp"
+#include "InputJournal.hpp"
 #include "types.hpp"
 #include "events.hpp"
 #include "math.hpp"
@@ -19,6 +19,8 @@
 #include "Geodata.hpp"
 #include "World.hpp"
 #include "ObjectManager.hpp"
+#include "TickProfiler.hpp"
+#include "TimerWheel.hpp"
 
 class Game
 {
@@ -29,7 +31,7 @@ public:
     void operator=(const Game&) = delete;
 
     const GameCfg& m_cfg;
-    Geodata m_geodata{m_cfg.worldCX, m_cfg.worldCY};
+    Geodata m_geodata{m_world};
 
     ticks_t now() const { return m_now; }
 
@@ -37,12 +39,55 @@ public:
     {
         ++m_now;
         updateObjects();
+
+        if (m_cfg.compactObjects)
+            m_objects.compactIfSparse();
+    }
+
+    const WorkerStatsArray& workerStats() const { return m_objects.workerStats(); }
+
+    TickProfiler& profiler() { return m_profiler; }
+
+    // visits every live object; for checks and dumps between ticks
+    template<typename F>
+    void forEachObject(F&& f)
+    {
+        m_objects.for_each([&](Object& obj) { f(static_cast<const Object&>(obj)); });
+    }
+
+    // the object the World holds at `pt`; null for empty and locked cells
+    const Object* cellObject(const Point& pt)
+    {
+        auto objPtr = objectAt(pt);
+        return objPtr ? &objPtr->asObject() : nullptr;
+    }
+
+    bool isCellFree(const Point& pt) const { return m_world.isFree(pt); }
+
+    // calls `f(chunkIdx, pt, cellFlags, holder)` for the cells of the World's
+    // allocated chunks; the holder occupies or has locked the cell, else null
+    template<typename F>
+    void forEachWorldCell(F&& f)
+    {
+        m_world.forEachAllocatedCell([&](std::size_t ci, const Point& pt, std::uint32_t flags, World::Handle handle)
+        {
+            f(ci, pt, flags, handle == World::NoObject ? nullptr : &m_objects.getObjectByHandle(handle));
+        });
     }
 
+    // records the inputs of the following ticks into `journal`, null stops recording
+    void setJournal(JournalWriter* journal) { m_journal = journal; }
+
     void enqueueAction(ObjectId id, ActionData action)
     {
         if (auto objPtr = m_objects.findObject(id))
+        {
+            if (m_journal)
+                m_journal->action(now(), id, action);
+
             objPtr->setNextAction(action);
+            m_objects.markHasAction(*objPtr);
+        }
     }
 
     void newPlayer(EventHandler& eventHandler, Point pos, std::string name)
@@ -51,27 +96,31 @@ public:
         {
             onDisconnect(objPtr->asObject());
             objPtr->disconnect();
+            m_objects.markChanged(*objPtr, 0);
         }
 
         auto&& obj = m_objects.newObject();
         obj.m_eventHandler = &eventHandler;
 
         obj.m_name = std::move(name);
-        obj.m_pos = pos;
+        obj.pos() = pos;
+
+        if (m_journal)
+            m_journal->newPlayer(now(), obj.m_id, pos, obj.m_name);
      
         InitInfo initInfo;
         initInfo.m_id = obj.m_id;
         initInfo.m_name = obj.m_name;
-        initInfo.m_pos = obj.m_pos;
+        initInfo.m_pos = obj.pos();
         initInfo.m_health = obj.m_health;
         obj.m_eventHandler->init(initInfo);
 
-        assert(!m_world.objectAt(pos));
-        m_world.addObject(obj.m_id, obj.m_pos);
+        assert(m_world.isFree(pos));
+        m_world.addObject(obj.m_id, obj.pos());
 
         auto&& newPlayerInfo = obj.getFullInfo();
 
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
             if (&obj != &otherObj)
             {
@@ -87,7 +136,7 @@ private:
     {
         obj.m_eventHandler->disconnect();
         
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
             if (&obj != &otherObj && otherObj.m_eventHandler)
             {
@@ -95,71 +144,62 @@ private:
             }
         });
         
-        assert(m_world.objectAt(obj.m_pos) == obj.m_id);
-        m_world.removeObject(obj.m_pos);
+        assert(m_world.objectAt(obj.pos()) == obj.m_id.f.index);
+        m_world.removeObject(obj.pos());
 
-        if (obj.m_state == PlayerState::MovingOut)
+        if (obj.state() == PlayerState::MovingOut)
         {
-            m_world.removeObject(moveRel(obj.m_pos, obj.m_moveDir));
+            m_world.removeObject(moveRel(obj.pos(), obj.moveDir()));
         }
     }
 
-    bool canMoveTo(const Point& srcPt, Dir moveDir)
+    bool canMoveTo(const Point& srcPt, Dir moveDir) const
     {
-        auto destPt = moveRel(srcPt, moveDir);
-
-        if (!destPt.inside(m_cfg.worldCX, m_cfg.worldCY))
-            return false;
-
-        if (!m_geodata.canMove(srcPt, moveDir))
-            return false;
-
-        if (m_world.objectAt(destPt))
-            return false;
-
-        return true;
+        return m_world.canMove(srcPt, moveDir);
     }
 
-    void beginMove(Object& obj, Dir direction)
+    void beginMove(Object& obj, Dir direction, ThrdIdx threadIdx)
     {
-        if (obj.m_state != PlayerState::Idle)
+        if (obj.state() != PlayerState::Idle)
             return;
 
-        if (!canMoveTo(obj.m_pos, direction))
+        if (!canMoveTo(obj.pos(), direction))
             return;
 
-        auto destPoint = moveRel(obj.m_pos, direction);
-        m_world.lockCell(obj.m_id, destPoint);
+        // a mover on another worker may have taken the cell since the check
+        auto destPoint = moveRel(obj.pos(), direction);
+        if (!m_world.lockCell(obj.m_id, destPoint))
+            return;
 
-        obj.m_state = PlayerState::MovingOut;
-        obj.m_moveDir = direction;
+        obj.state() = PlayerState::MovingOut;
+        obj.moveDir() = direction;
 
-        setTimer(obj, m_cfg.moveTicks, [this](Object& o, ThrdIdx){ onCrossCellBorder(o); });
+        setTimer(obj, m_cfg.moveTicks, TimerAction::CrossCellBorder, threadIdx);
 
         auto&& moveInfo = obj.getMoveInfo();
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
             if (otherObj.m_eventHandler)
                 otherObj.m_eventHandler->seeBeginMove(moveInfo);
         });
     }
 
-    void onCrossCellBorder(Object& obj)
+    void onCrossCellBorder(Object& obj, ThrdIdx threadIdx)
     {
-        auto oldPos = obj.m_pos;
+        auto oldPos = obj.pos();
 
-        assert(obj.m_state == PlayerState::MovingOut);
-        obj.m_state = PlayerState::MovingIn;
-        obj.m_pos = moveRel(obj.m_pos, obj.m_moveDir);
+        assert(obj.state() == PlayerState::MovingOut);
+        obj.state() = PlayerState::MovingIn;
+        obj.pos() = moveRel(obj.pos(), obj.moveDir());
 
-        m_world.moveToCell(oldPos, obj.m_pos);
+        m_world.moveToCell(oldPos, obj.pos());
 
-        setTimer(obj, m_cfg.moveTicks, [this](Object& o, ThrdIdx){ onStopMove(o); });
+        setTimer(obj, m_cfg.moveTicks, TimerAction::StopMove, threadIdx);
 
         auto&& fullInfo = obj.getFullInfo();
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
-            bool seeAppears = isOnArc180(obj.m_pos, m_cfg.playerViewRadius, obj.m_moveDir, otherObj.m_pos);
+            bool seeAppears = isOnArc180(obj.pos(), m_cfg.playerViewRadius, obj.moveDir(), otherObj.pos());
 
             if (seeAppears)
                 obj.m_eventHandler->seePlayer(otherObj.getFullInfo());
@@ -177,7 +217,7 @@ private:
             }
         });
 
-        forArc180(oldPos, m_cfg.playerViewRadius, oppositeDir(obj.m_moveDir), [&](const Point& pt)
+        forArc180(oldPos, m_cfg.playerViewRadius, oppositeDir(obj.moveDir()), [&](const Point& pt)
         {
             if (auto otherObjPtr = objectAt(pt))
             {
@@ -193,30 +233,29 @@ private:
 
     void onStopMove(Object& obj)
     {
-        assert(obj.m_state == PlayerState::MovingIn);
-        obj.m_state = PlayerState::Idle;
+        assert(obj.state() == PlayerState::MovingIn);
+        obj.state() = PlayerState::Idle;
 
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
             if (otherObj.m_eventHandler)
                 otherObj.m_eventHandler->seeStop(obj.m_id);
         });
     }
 
-    void beginCast(Object& obj, Spell spell, const Point& dest)
+    void beginCast(Object& obj, Spell spell, const Point& dest, ThrdIdx threadIdx)
     {
-        if (obj.m_state != PlayerState::Idle)
+        if (obj.state() != PlayerState::Idle)
             return;
 
-        obj.m_state = PlayerState::Casting;
+        obj.state() = PlayerState::Casting;
         obj.m_spell = spell;
         obj.m_castDest = dest;
 
-        setTimer(obj, m_cfg.castTicks,
-            [this](Object& o, ThrdIdx threadIdx){ onEndCast(o, threadIdx); });
+        setTimer(obj, m_cfg.castTicks, TimerAction::EndCast, threadIdx);
 
         auto&& castInfo = obj.getCastInfo();
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
             if (otherObj.m_eventHandler)
                 otherObj.m_eventHandler->seeBeginCast(castInfo);
@@ -225,10 +264,10 @@ private:
 
     void onEndCast(Object& obj, ThrdIdx threadIdx)
     {
-        assert(obj.m_state == PlayerState::Casting);
-        obj.m_state = PlayerState::Idle;
+        assert(obj.state() == PlayerState::Casting);
+        obj.state() = PlayerState::Idle;
 
-        forObjectsAround(obj.m_pos, [&](Object& otherObj)
+        forObjectsAround(obj.pos(), [&](Object& otherObj)
         {
             if (otherObj.m_eventHandler)
                 otherObj.m_eventHandler->seeEndCast(obj.m_id);
@@ -286,6 +325,7 @@ private:
         assert(spellIdx < m_cfg.spellHpDelta.size());
         auto hpDelta = m_cfg.spellHpDelta[spellIdx];
         obj.modifyHP(hpDelta, threadIdx);
+        m_objects.markChanged(obj, threadIdx);
     }
 
     void updateHealth(Object& obj)
@@ -307,27 +347,27 @@ private:
     template<typename Callback>
     void forObjectsAround(Point pt, Callback&& callback)
     {
-        m_objects.for_each([&](Object& obj)
+        m_world.forObjectsAround(pt, m_cfg.playerViewRadius, [&](World::Handle handle)
         {
-            if (distance(pt, obj.m_pos) <= m_cfg.playerViewRadius)
-                callback(obj);
+            callback(m_objects.getObjectByHandle(handle));
         });
     }
 
-    void dispatchAction(Object& obj, const ActionData& a)
+    void dispatchAction(Object& obj, const ActionData& a, ThrdIdx threadIdx)
     {
         switch (a.m_action)
         {
         case Action::Disconnect:
             obj.m_erased = true;
+            m_objects.markChanged(obj, threadIdx);
             break;
 
         case Action::Move:
-            beginMove(obj, a.m_moveDir);
+            beginMove(obj, a.m_moveDir, threadIdx);
             break;
 
         case Action::Cast:
-            beginCast(obj, a.m_spell, a.m_castDest);
+            beginCast(obj, a.m_spell, a.m_castDest, threadIdx);
             break;
 
         case Action::None:
@@ -336,59 +376,103 @@ private:
         }
     }
 
+    void onTimer(Object& obj, TimerAction timerAction, ThrdIdx threadIdx)
+    {
+        switch (timerAction)
+        {
+        case TimerAction::CrossCellBorder:
+            onCrossCellBorder(obj, threadIdx);
+            break;
+
+        case TimerAction::StopMove:
+            onStopMove(obj);
+            break;
+
+        case TimerAction::EndCast:
+            onEndCast(obj, threadIdx);
+            break;
+
+        case TimerAction::None:
+        default:
+            assert(!"unknown timer action");
+        }
+    }
+
     void updateObjects()
     {
-        m_objects.parallel_for_each([&](Object& obj, ThrdIdx threadIdx)
         {
-            if (!obj.m_nextAction.empty())
+            TickProfiler::Scope scope{m_profiler, TickPhase::Actions};
+            m_objects.parallel_for_each_with_action([&](Object& obj, ThrdIdx threadIdx)
             {
-                dispatchAction(obj, obj.m_nextAction);
-                obj.m_nextAction.clear();
-            }
+                if (!obj.nextAction().empty())
+                {
+                    dispatchAction(obj, obj.nextAction(), threadIdx);
+                    obj.nextAction().clear();
+                }
+            });
+        }
+
+        {
+            TickProfiler::Scope scope{m_profiler, TickPhase::Timers};
+            m_dueTimers.clear();
+            m_timers.expire(now(), m_dueTimers);
 
-            if (obj.m_timerCallback && now() >= obj.m_timerDeadline)
+            m_objects.parallel_for_each(m_dueTimers, [&](Object& obj, ThrdIdx threadIdx)
             {
-                decltype(obj.m_timerCallback) callback;
-                callback.swap(obj.m_timerCallback);
-                callback(obj, threadIdx);
-            }
-        });
+                if (obj.m_timerAction != TimerAction::None && now() >= obj.timerDeadline())
+                {
+                    auto timerAction = obj.m_timerAction;
+                    obj.m_timerAction = TimerAction::None;
+                    onTimer(obj, timerAction, threadIdx);
+                }
+            });
+        }
 
-        m_objects.parallel_for_each([&](Object& obj, ThrdIdx threadIdx)
         {
-            updateHealth(obj);
+            TickProfiler::Scope scope{m_profiler, TickPhase::Changed};
+            m_objects.mergeChangedLists();
 
-            if (obj.m_erased)
+            m_objects.parallel_for_each_changed([&](Object& obj, ThrdIdx threadIdx)
             {
-                onDisconnect(obj);
-                m_objects.eraseObject(obj, threadIdx);
-            }
-        });
+                updateHealth(obj);
 
+                if (obj.m_erased)
+                {
+                    onDisconnect(obj);
+                    m_objects.eraseObject(obj, threadIdx);
+                }
+            });
+        }
+
+        TickProfiler::Scope scope{m_profiler, TickPhase::MergeErased};
         m_objects.mergeErasedObjectsLists();
+        m_timers.mergeStaged();
+        m_world.releaseEmptyChunks();
     }
 
     ObjectAPI* objectAt(const Point& pt)
     {
-        if (auto id = m_world.objectAt(pt))
-        {
-            auto objPtr = m_objects.findObject(id);
-            assert(objPtr && "inconsistent World data");
-            return objPtr;
-        }
+        auto handle = m_world.objectAt(pt);
+        if (handle == World::NoObject)
+            return nullptr;
 
-        return nullptr;
+        return &m_objects.getObjectByHandle(handle);
     }
 
-    template<typename Callback>
-    void setTimer(Object& obj, int delay, Callback&& callback)
+    void setTimer(Object& obj, int delay, TimerAction timerAction, ThrdIdx threadIdx)
     {
-        assert(!obj.m_timerCallback);
-        obj.m_timerDeadline = now() + delay;
-        obj.m_timerCallback = std::forward<Callback>(callback);
+        assert(obj.m_timerAction == TimerAction::None);
+        assert(delay > 0 && "timers are merged into the wheel at the end of the tick");
+        obj.timerDeadline() = now() + delay;
+        obj.m_timerAction = timerAction;
+        m_timers.add(obj.m_id, obj.timerDeadline(), threadIdx);
     }
 
     ObjectManager m_objects{m_cfg.threadsCount};
     World m_world{m_cfg.worldCX, m_cfg.worldCY};
+    TimerWheel m_timers;
+    std::vector<ObjectId> m_dueTimers;
     ticks_t m_now{0};
+    TickProfiler m_profiler;
+    JournalWriter* m_journal{nullptr};
 };
\ No newline at end of file
@@ -11,6 +11,9 @@ struct GameCfg
     int moveTicks{1};
     int castTicks{1};
     std::array<int, 2> spellHpDelta{{-51, +26}};
+    int ticksPerSecond{20};
+    int maxCatchUpTicks{5};  // ticks run back to back before the schedule is rebased
     unsigned threadsCount{1};
+    bool compactObjects{true};
 };
 
@@ -1,46 +1,31 @@
 #pragma once
 
-#include <cassert>
-#include <vector>
-
 #include "types.hpp"
 #include "math.hpp"
+#include "World.hpp"
+#include "MapFile.hpp"
 
+// Map-loading view of the walls; wall bits are stored in the World cells
+// next to the occupancy, so Game::canMoveTo needs a single lookup.
 struct Geodata
 {
-    Geodata(int cx, int cy)
-        : m_table(cx * cy)
-        , m_cx{cx}
-        , m_cy{cy}
-    {}
+    explicit Geodata(World& world) : m_world{&world} {}
 
     void addWall(const Point& pt)
     {
-        if (pt.x > 0) m_table[idx(moveRel(pt, Dir::Left))] |= dirMask(Dir::Right);
-        if (pt.y > 0) m_table[idx(moveRel(pt, Dir::Up))] |= dirMask(Dir::Down);
-        if (pt.x < m_cx - 1) m_table[idx(moveRel(pt, Dir::Right))] |= dirMask(Dir::Left);
-        if (pt.y < m_cy - 1) m_table[idx(moveRel(pt, Dir::Down))] |= dirMask(Dir::Up);
+        m_world->addWall(pt);
     }
 
-    bool canMove(const Point& pt, Dir moveDir) const
+    void loadWalls(const MapFile& map)
     {
-        assert(pt.inside(m_cx, m_cy));
-        auto cellInfo = m_table[idx(pt)];
-        return (cellInfo & dirMask(moveDir)) == 0;
+        m_world->addWalls([&](int x, int y) { return map.wallBits(x, y); });
     }
 
-private:
-    int idx(const Point& pt) const
-    {
-        return pt.x + pt.y * m_cx;
-    }
-
-    static std::uint8_t dirMask(Dir direction)
+    bool canMove(const Point& pt, Dir moveDir) const
     {
-        return 1 << static_cast<int>(direction);
+        return !m_world->hasWall(pt, moveDir);
     }
 
-    std::vector<std::uint8_t> m_table;
-    int m_cx, m_cy;
+private:
+    World* m_world;
 };
-
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GameCfg.hpp"
+#include "MapFile.hpp"
+#include "Object.hpp"
+#include "types.hpp"
+
+// Binary journal of the inputs that drive Game, for replaying a session
+// without networking:
+//   JournalHeader
+//   map image, JournalHeader::m_mapWords 64-bit words (see MapFile)
+//   records until the end of the file
+// A record is a kind byte, the tick delta since the previous record and the
+// player's sequence number, all but the kind as LEB128 varints, then:
+//   NewPlayer: x, y, name size, name bytes
+//   Action:    action byte; Move: dir byte; Cast: spell byte, zigzag x, zigzag y
+// Players are numbered in the order they joined, so a replay doesn't depend on
+// how ObjectIds get allocated. The header and the map image are in host byte
+// order, like map files; a journal from a host of the other byte order fails
+// the magic check. Records are byte-oriented.
+struct JournalHeader
+{
+    static const std::uint32_t Magic = 0x4c4e4a54; // "TJNL"
+    static const std::uint32_t CurrentVersion = 1;
+
+    std::uint32_t m_magic;
+    std::uint32_t m_version;
+    std::int32_t m_worldCX;
+    std::int32_t m_worldCY;
+    std::int32_t m_playerViewRadius;
+    std::int32_t m_moveTicks;
+    std::int32_t m_castTicks;
+    std::int32_t m_spellHpDelta[2];
+    std::uint32_t m_mapWords;
+};
+
+struct JournalEntry
+{
+    enum class Kind : std::uint8_t { NewPlayer = 1, Action };
+
+    Kind m_kind;
+    ticks_t m_tick;
+    std::uint32_t m_player;
+
+    Point m_pos;            // NewPlayer
+    std::string m_name;     // NewPlayer
+    ActionData m_action;    // Action
+};
+
+// Game calls it from the main thread only: newPlayer() and enqueueAction()
+// are never run in the parallel phases.
+class JournalWriter
+{
+public:
+    JournalWriter() = default;
+    JournalWriter(const JournalWriter&) = delete;
+    void operator=(const JournalWriter&) = delete;
+
+    ~JournalWriter() { close(); }
+
+    // `map` may be null; the replay then runs without walls
+    bool open(const std::string& path, const GameCfg& cfg, const MapFile* map)
+    {
+        close();
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_file)
+            return false;
+
+        JournalHeader header{JournalHeader::Magic, JournalHeader::CurrentVersion,
+            cfg.worldCX, cfg.worldCY, cfg.playerViewRadius, cfg.moveTicks, cfg.castTicks,
+            {cfg.spellHpDelta[0], cfg.spellHpDelta[1]},
+            map ? static_cast<std::uint32_t>(map->size() / sizeof(std::uint64_t)) : 0};
+        m_buf.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (map)
+            m_buf.append(map->data(), map->size());
+
+        m_lastTick = 0;
+        m_players.clear();
+        m_playersCount = 0;
+        return flush();
+    }
+
+    bool isOpen() const { return m_file.is_open(); }
+
+    void close()
+    {
+        if (m_file.is_open())
+        {
+            flush();
+            m_file.close();
+        }
+    }
+
+    void newPlayer(ticks_t tick, ObjectId id, const Point& pos, const std::string& name)
+    {
+        m_players[id.value] = m_playersCount;
+        record(JournalEntry::Kind::NewPlayer, tick, m_playersCount++);
+        varint(static_cast<std::uint32_t>(pos.x));
+        varint(static_cast<std::uint32_t>(pos.y));
+        varint(static_cast<std::uint32_t>(name.size()));
+        m_buf += name;
+        flushIfFull();
+    }
+
+    void action(ticks_t tick, ObjectId id, const ActionData& ad)
+    {
+        // players that joined before the journal was opened can't be replayed
+        auto it = m_players.find(id.value);
+        if (it == m_players.end())
+            return;
+
+        record(JournalEntry::Kind::Action, tick, it->second);
+        m_buf += static_cast<char>(ad.m_action);
+        switch (ad.m_action)
+        {
+        case Action::Move:
+            m_buf += static_cast<char>(ad.m_moveDir);
+            break;
+
+        case Action::Cast:
+            m_buf += static_cast<char>(ad.m_spell);
+            varint(zigzag(ad.m_castDest.x));
+            varint(zigzag(ad.m_castDest.y));
+            break;
+
+        default:
+            break;
+        }
+
+        flushIfFull();
+    }
+
+    bool flush()
+    {
+        m_file.write(m_buf.data(), m_buf.size());
+        m_buf.clear();
+        return !m_file.fail();
+    }
+
+private:
+    static const std::size_t FlushSize = 64 * 1024;
+
+    static std::uint32_t zigzag(int value)
+    {
+        return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    }
+
+    void record(JournalEntry::Kind kind, ticks_t tick, std::uint32_t player)
+    {
+        assert(tick >= m_lastTick);
+        m_buf += static_cast<char>(kind);
+        varint(tick - m_lastTick);
+        varint(player);
+        m_lastTick = tick;
+    }
+
+    void varint(std::uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            m_buf += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        m_buf += static_cast<char>(value);
+    }
+
+    void flushIfFull()
+    {
+        if (m_buf.size() >= FlushSize)
+            flush();
+    }
+
+    std::ofstream m_file;
+    std::string m_buf;
+    ticks_t m_lastTick{0};
+    std::unordered_map<std::uint64_t, std::uint32_t> m_players;
+    std::uint32_t m_playersCount{0};
+};
+
+// Reads a whole journal into memory and hands out its records in order.
+class JournalReader
+{
+public:
+    bool open(const std::string& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+            return false;
+
+        m_data.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+        if (m_data.size() < sizeof(JournalHeader))
+            return false;
+
+        std::memcpy(&m_header, m_data.data(), sizeof(m_header));
+        if (m_header.m_magic != JournalHeader::Magic || m_header.m_version != JournalHeader::CurrentVersion)
+            return false;
+
+        auto mapBytes = std::size_t{m_header.m_mapWords} * sizeof(std::uint64_t);
+        if (m_data.size() - sizeof(JournalHeader) < mapBytes)
+            return false;
+
+        if (mapBytes != 0)
+        {
+            std::vector<std::uint64_t> image(m_header.m_mapWords);
+            std::memcpy(image.data(), m_data.data() + sizeof(JournalHeader), mapBytes);
+            if (!m_map.fromImage(std::move(image)))
+                return false;
+        }
+
+        m_pos = sizeof(JournalHeader) + mapBytes;
+        m_tick = 0;
+        return true;
+    }
+
+    // the recorded GameCfg fields; threadsCount and compactObjects are left as they are
+    void loadCfg(GameCfg& cfg) const
+    {
+        cfg.worldCX = m_header.m_worldCX;
+        cfg.worldCY = m_header.m_worldCY;
+        cfg.playerViewRadius = m_header.m_playerViewRadius;
+        cfg.moveTicks = m_header.m_moveTicks;
+        cfg.castTicks = m_header.m_castTicks;
+        cfg.spellHpDelta = {{m_header.m_spellHpDelta[0], m_header.m_spellHpDelta[1]}};
+    }
+
+    bool hasMap() const { return m_header.m_mapWords != 0; }
+    bool atEnd() const { return m_pos == m_data.size(); }
+    const MapFile& map() const { return m_map; }
+
+    // false at the end of the journal or on a truncated record
+    bool next(JournalEntry& entry)
+    {
+        std::uint8_t kind;
+        std::uint32_t tickDelta;
+        if (!byte(kind) || !varint(tickDelta) || !varint(entry.m_player))
+            return false;
+
+        m_tick += tickDelta;
+        entry.m_tick = m_tick;
+        entry.m_kind = static_cast<JournalEntry::Kind>(kind);
+
+        switch (entry.m_kind)
+        {
+        case JournalEntry::Kind::NewPlayer:
+        {
+            std::uint32_t x, y, nameSize;
+            if (!varint(x) || !varint(y) || !varint(nameSize) || m_data.size() - m_pos < nameSize)
+                return false;
+
+            entry.m_pos = {static_cast<int>(x), static_cast<int>(y)};
+            entry.m_name.assign(m_data.data() + m_pos, nameSize);
+            m_pos += nameSize;
+            return true;
+        }
+
+        case JournalEntry::Kind::Action:
+            return readAction(entry.m_action);
+        }
+
+        return false;
+    }
+
+private:
+    bool readAction(ActionData& ad)
+    {
+        std::uint8_t action;
+        if (!byte(action))
+            return false;
+
+        ad = {};
+        ad.m_action = static_cast<Action>(action);
+        switch (ad.m_action)
+        {
+        case Action::Move:
+        {
+            std::uint8_t dir;
+            if (!byte(dir))
+                return false;
+            ad.m_moveDir = static_cast<Dir>(dir);
+            return true;
+        }
+
+        case Action::Cast:
+        {
+            std::uint8_t spell;
+            std::uint32_t x, y;
+            if (!byte(spell) || !varint(x) || !varint(y))
+                return false;
+            ad.m_spell = static_cast<Spell>(spell);
+            ad.m_castDest = {unzigzag(x), unzigzag(y)};
+            return true;
+        }
+
+        case Action::Disconnect:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    static int unzigzag(std::uint32_t value)
+    {
+        return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+    }
+
+    bool byte(std::uint8_t& value)
+    {
+        if (m_pos == m_data.size())
+            return false;
+        value = static_cast<std::uint8_t>(m_data[m_pos++]);
+        return true;
+    }
+
+    bool varint(std::uint32_t& value)
+    {
+        value = 0;
+        for (auto shift = 0; shift < 35; shift += 7)
+        {
+            std::uint8_t b;
+            if (!byte(b))
+                return false;
+
+            value |= static_cast<std::uint32_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    std::string m_data;
+    std::size_t m_pos{0};
+    JournalHeader m_header{};
+    MapFile m_map;
+    ticks_t m_tick{0};
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "math.hpp"
+#include "MappedFile.hpp"
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+// Binary world map, used in place after mapping:
+//   MapHeader
+//   wall bits, one per cell, row-major, packed into 64-bit words
+//   MapSpawn[m_spawnsCount], all inside the map
+// Fields are in host byte order, since the file is used in place; a file
+// written on a host of the other byte order fails the magic check.
+struct MapHeader
+{
+    static const std::uint32_t Magic = 0x50414d54; // "TMAP"
+    static const std::uint32_t CurrentVersion = 1;
+
+    std::uint32_t m_magic;
+    std::uint32_t m_version;
+    std::int32_t m_cx;
+    std::int32_t m_cy;
+    std::uint32_t m_spawnsCount;
+    std::uint32_t m_reserved; // keeps the wall words 8-byte aligned
+};
+
+struct MapSpawn
+{
+    std::int32_t x, y;
+};
+
+class MapFile
+{
+public:
+    // loads a file written by tools/map_convert
+    bool open(const std::string& path)
+    {
+        m_header = nullptr;
+        m_image.clear();
+        if (m_file.open(path) && attach(m_file.data(), m_file.size()))
+            return true;
+
+        m_file.close();
+        return false;
+    }
+
+    // builds the binary image of a text map in memory
+    bool fromText(int cx, const std::string& cells)
+    {
+        m_header = nullptr;
+        m_file.close();
+        return encodeTextMap(cx, cells, m_image)
+            && attach(reinterpret_cast<const char*>(m_image.data()), m_image.size() * sizeof(m_image[0]));
+    }
+
+    // takes a binary image, e.g. one saved from data() and size()
+    bool fromImage(std::vector<std::uint64_t> image)
+    {
+        m_header = nullptr;
+        m_file.close();
+        m_image = std::move(image);
+        return attach(reinterpret_cast<const char*>(m_image.data()), m_image.size() * sizeof(m_image[0]));
+    }
+
+    // Text map: `cx` cells per row, '.' is empty, 'W' is a wall, '?' is a spawn point.
+    // The image is kept in 64-bit words so the wall bits are aligned like in a mapped file.
+    static bool encodeTextMap(int cx, const std::string& cells, std::vector<std::uint64_t>& image)
+    {
+        if (cx <= 0 || cells.empty() || cells.size() % cx != 0)
+            return false;
+
+        MapHeader header{MapHeader::Magic, MapHeader::CurrentVersion, cx, static_cast<std::int32_t>(cells.size() / cx), 0, 0};
+        std::vector<MapSpawn> spawns;
+
+        image.assign(HeaderWords + wallWordsCount(header.m_cx, header.m_cy), 0);
+        auto walls = image.data() + HeaderWords;
+        for (auto idx = std::size_t{0}; idx != cells.size(); ++idx)
+        {
+            switch (cells[idx])
+            {
+            case '.': break;
+            case 'W': walls[idx >> 6] |= std::uint64_t{1} << (idx & 63); break;
+            case '?': spawns.push_back({static_cast<std::int32_t>(idx % cx), static_cast<std::int32_t>(idx / cx)}); break;
+            default: return false;
+            }
+        }
+
+        header.m_spawnsCount = static_cast<std::uint32_t>(spawns.size());
+        std::memcpy(image.data(), &header, sizeof(header));
+
+        image.resize(image.size() + spawns.size());
+        if (!spawns.empty())
+            std::memcpy(image.data() + image.size() - spawns.size(), spawns.data(), spawns.size() * sizeof(MapSpawn));
+        return true;
+    }
+
+    // the binary image, as stored in a map file
+    const char* data() const { return reinterpret_cast<const char*>(m_header); }
+    std::size_t size() const { return m_size; }
+
+    int cx() const { return m_header->m_cx; }
+    int cy() const { return m_header->m_cy; }
+
+    bool isWall(const Point& pt) const
+    {
+        auto bit = static_cast<std::size_t>(pt.y) * cx() + pt.x;
+        return (m_walls[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    // walls of cells [x, x + 64) in row `y`, bit 0 is cell `x`;
+    // cells outside the map read as no wall
+    std::uint64_t wallBits(int x, int y) const
+    {
+        if (y < 0 || y >= cy())
+            return 0;
+
+        auto begin = std::max(x, 0);
+        auto end = std::min(x + 64, cx());
+        if (begin >= end)
+            return 0;
+
+        auto first = static_cast<std::size_t>(y) * cx() + begin;
+        auto word = first >> 6;
+        auto shift = first & 63;
+        auto bits = m_walls[word] >> shift;
+        if (shift != 0 && word + 1 != wallWordsCount(cx(), cy()))
+            bits |= m_walls[word + 1] << (64 - shift);
+
+        auto count = end - begin;
+        if (count != 64)
+            bits &= (std::uint64_t{1} << count) - 1;
+        return bits << (begin - x);
+    }
+
+    // calls `f(Point)` for every wall; empty words are skipped
+    template<typename F>
+    void forEachWall(F&& f) const
+    {
+        auto wordsCount = wallWordsCount(cx(), cy());
+        for (auto w = std::size_t{0}; w != wordsCount; ++w)
+        {
+            for (auto word = m_walls[w]; word != 0; word &= word - 1)
+            {
+                auto bit = w * 64 + lowestBit(word);
+                f(Point{static_cast<int>(bit % cx()), static_cast<int>(bit / cx())});
+            }
+        }
+    }
+
+    std::vector<Point> spawns() const
+    {
+        std::vector<Point> points;
+        for (auto i = 0u; i != m_header->m_spawnsCount; ++i)
+            points.emplace_back(m_spawns[i].x, m_spawns[i].y);
+        return points;
+    }
+
+private:
+    static const std::size_t HeaderWords = sizeof(MapHeader) / sizeof(std::uint64_t);
+    static_assert(sizeof(MapHeader) % sizeof(std::uint64_t) == 0, "wall words must stay aligned");
+    static_assert(sizeof(MapSpawn) == sizeof(std::uint64_t), "spawns are stored one per word");
+
+    static std::size_t wallWordsCount(int cx, int cy)
+    {
+        return (static_cast<std::size_t>(cx) * cy + 63) / 64;
+    }
+
+    static unsigned lowestBit(std::uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward64(&idx, word);
+        return idx;
+#else
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+    }
+
+    bool attach(const char* data, std::size_t size)
+    {
+        if (size < sizeof(MapHeader))
+            return false;
+
+        auto header = reinterpret_cast<const MapHeader*>(data);
+        if (header->m_magic != MapHeader::Magic || header->m_version != MapHeader::CurrentVersion
+            || header->m_cx <= 0 || header->m_cy <= 0)
+            return false;
+
+        auto wallWords = wallWordsCount(header->m_cx, header->m_cy);
+        if (size != (HeaderWords + wallWords + header->m_spawnsCount) * sizeof(std::uint64_t))
+            return false;
+
+        auto walls = reinterpret_cast<const std::uint64_t*>(data) + HeaderWords;
+        auto spawns = reinterpret_cast<const MapSpawn*>(walls + wallWords);
+        for (auto i = 0u; i != header->m_spawnsCount; ++i)
+        {
+            if (!Point{spawns[i].x, spawns[i].y}.inside(header->m_cx, header->m_cy))
+                return false;
+        }
+
+        m_header = header;
+        m_size = size;
+        m_walls = walls;
+        m_spawns = spawns;
+        return true;
+    }
+
+    MappedFile m_file;
+    std::vector<std::uint64_t> m_image;
+
+    const MapHeader* m_header{nullptr};
+    std::size_t m_size{0};
+    const std::uint64_t* m_walls{nullptr};
+    const MapSpawn* m_spawns{nullptr};
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+// Read-only view of a whole file, mapped into memory.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    void operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path)
+    {
+        close();
+
+#ifdef _WIN32
+        auto file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        auto mapping = ::GetFileSizeEx(file, &size) && size.QuadPart != 0
+            ? ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+            : nullptr;
+        ::CloseHandle(file);
+        if (!mapping)
+            return false;
+
+        m_data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        ::CloseHandle(mapping);
+        if (!m_data)
+            return false;
+
+        m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+
+        struct stat st;
+        auto addr = ::fstat(fd, &st) == 0 && st.st_size != 0
+            ? ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0)
+            : MAP_FAILED;
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            return false;
+
+        m_data = static_cast<const char*>(addr);
+        m_size = static_cast<std::size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void close()
+    {
+        if (!m_data)
+            return;
+
+#ifdef _WIN32
+        ::UnmapViewOfFile(m_data);
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const char* m_data{nullptr};
+    std::size_t m_size{0};
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "build_config.hpp"
 #include "types.hpp"
@@ -21,10 +23,21 @@ struct ActionData
     void clear() { m_action = Action::None; }
 };
 
+// what happens when an object's timer expires
+enum class TimerAction : std::uint8_t
+{
+    None, CrossCellBorder, StopMove, EndCast,
+};
+
 class TableBase
 {
     friend class ObjectManager;
     bool m_isFree{false};
+    bool m_inActionList{false};
+    bool m_inChangedList{false};
+
+protected:
+    unsigned m_slot{0};
 };
 
 struct ObjectAPI : TableBase
@@ -45,48 +58,102 @@ protected:
     ~ObjectAPI() = default;
 };
 
+// Hot per-object fields, stored column-wise so the tick loops touch
+// contiguous memory. Indexed by the object's slot in ObjectManager.
+struct ObjectColumns
+{
+    std::vector<Point> m_pos;
+    std::vector<PlayerState> m_state;
+    std::vector<Dir> m_moveDir;
+    std::vector<ticks_t> m_timerDeadline;
+    std::vector<ActionData> m_nextAction;
+
+    void push_back()
+    {
+        m_pos.emplace_back();
+        m_state.emplace_back();
+        m_moveDir.emplace_back();
+        m_timerDeadline.emplace_back();
+        m_nextAction.emplace_back();
+    }
+
+    void resize(unsigned n)
+    {
+        m_pos.resize(n);
+        m_state.resize(n);
+        m_moveDir.resize(n);
+        m_timerDeadline.resize(n);
+        m_nextAction.resize(n);
+    }
+
+    void move(unsigned from, unsigned to)
+    {
+        m_pos[to] = m_pos[from];
+        m_state[to] = m_state[from];
+        m_moveDir[to] = m_moveDir[from];
+        m_timerDeadline[to] = m_timerDeadline[from];
+        m_nextAction[to] = m_nextAction[from];
+    }
+
+    void reset(unsigned idx)
+    {
+        m_pos[idx] = {};
+        m_state[idx] = PlayerState::Idle;
+        m_moveDir[idx] = {};
+        m_timerDeadline[idx] = {};
+        m_nextAction[idx] = {};
+    }
+};
+
+// Cold per-object fields; the hot ones are reached through the accessors.
 struct Object : public ObjectAPI
 {
-    Object(ObjectId id)
+    Object(ObjectId id, ObjectColumns& columns)
         : ObjectAPI{id}
         , m_healthDelta{} // put it here as a workaround for VC++2013RC ICE
+        , m_columns{&columns}
     {}
 
     std::string m_name;
 
-    Point m_pos;
-    PlayerState m_state{PlayerState::Idle};
-
-    Dir m_moveDir;
-
     Spell m_spell;
     Point m_castDest;
 
     int m_health{100};
 
-    ActionData m_nextAction;
-
-    ticks_t m_timerDeadline;
-    std::function<void(Object&, ThrdIdx)> m_timerCallback;
+    TimerAction m_timerAction{TimerAction::None};
 
     volatile bool m_erased{false};
 
     std::array<int, MaxThreads> m_healthDelta;
 
+    Point& pos() { return m_columns->m_pos[slot()]; }
+    const Point& pos() const { return m_columns->m_pos[slot()]; }
+
+    PlayerState& state() { return m_columns->m_state[slot()]; }
+    PlayerState state() const { return m_columns->m_state[slot()]; }
+
+    Dir& moveDir() { return m_columns->m_moveDir[slot()]; }
+    Dir moveDir() const { return m_columns->m_moveDir[slot()]; }
+
+    ticks_t& timerDeadline() { return m_columns->m_timerDeadline[slot()]; }
+    ticks_t timerDeadline() const { return m_columns->m_timerDeadline[slot()]; }
+
+    ActionData& nextAction() { return m_columns->m_nextAction[slot()]; }
+    const ActionData& nextAction() const { return m_columns->m_nextAction[slot()]; }
+
     Point moveDest() const
     {
-        auto pt = m_pos;
-        moveRel(pt, m_moveDir);
-        return pt;
+        return moveRel(pos(), moveDir());
     }
 
     FullPlayerInfo getFullInfo() const
     {
         FullPlayerInfo inf;
         inf.m_id = m_id;
-        inf.m_pos = m_pos;
-        inf.m_state = m_state;
-        inf.m_moveDir = m_moveDir;
+        inf.m_pos = pos();
+        inf.m_state = state();
+        inf.m_moveDir = moveDir();
         inf.m_spell = m_spell;
         inf.m_name = m_name;
         return inf;
@@ -94,7 +161,7 @@ struct Object : public ObjectAPI
 
     MoveInfo getMoveInfo() const
     {
-        MoveInfo inf = {m_id, m_moveDir};
+        MoveInfo inf = {m_id, moveDir()};
         return inf;
     }
 
@@ -109,7 +176,7 @@ private: // ObjectAPI implementation
 
     virtual void setNextAction(ActionData ad) override
     {
-        m_nextAction = std::move(ad);
+        nextAction() = std::move(ad);
     }
 
     virtual void disconnect() override { m_erased = true; }
@@ -118,4 +185,9 @@ private: // ObjectAPI implementation
     {
         m_healthDelta[threadIdx] += delta;
     }
+
+private:
+    unsigned slot() const { return m_slot; }
+
+    ObjectColumns* m_columns;
 };
\ No newline at end of file
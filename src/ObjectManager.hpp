@@ -1,120 +1,401 @@
 #pragma once
 
 #include <cassert>
-#include <atomic>
-#include <deque>
-#include <list>
-#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 #include "build_config.hpp"
 #include "types.hpp"
 #include "Object.hpp"
+#include "WorkerPool.hpp"
+#include "BlockScheduler.hpp"
 
+// Objects live in fixed-size chunks, so growing the table never moves them.
+// ObjectId::index is a handle: the handle table maps it to the object's slot,
+// which lets compact() move objects without changing their ids. Free handles
+// and free slots are chained through the freed entries themselves.
 class ObjectManager
 {
 public:
-    ObjectManager(unsigned threadsCount) : m_threadsCount{threadsCount} {}
+    ObjectManager(unsigned threadsCount) : m_workers{threadsCount} {}
 
-    Object& newObject()
+    ObjectManager(const ObjectManager&) = delete;
+    void operator=(const ObjectManager&) = delete;
+
+    ~ObjectManager()
     {
-        if (m_free.empty())
+        for (auto slot = 0u; slot != m_slotsCount; ++slot)
         {
-            m_arr.emplace_back(ObjectId(m_arr.size()));
-            return m_arr.back();
+            if (m_slotHandle[slot] != NoIndex)
+                objectAt(slot).~Object();
         }
+    }
+
+    Object& newObject()
+    {
+        auto handle = allocHandle();
+        auto slot = allocSlot();
 
-        auto idx = m_free.front();
-        m_free.pop_front();
-        auto& el = m_arr[idx];
-        assert(el.m_isFree);
-        ++el.m_id.f.version;
-        el = Object(el.m_id);
-        return el;
+        ObjectId id{handle};
+        id.f.version = m_handles[handle].m_version;
+        m_handles[handle].m_slot = slot;
+        m_slotHandle[slot] = handle;
+        m_columns.reset(slot);
+        ++m_liveCount;
+
+        auto obj = new (slotPtr(slot)) Object(id, m_columns);
+        obj->m_slot = slot;
+        return *obj;
     }
 
     ObjectAPI* findObject(ObjectId id)
     {
-        auto idx = id.f.index;
-        if (idx >= m_arr.size())
-            return nullptr;
-        auto&& el = m_arr[idx];
-        return (!el.m_isFree && el.m_id == id) ? &el : nullptr;
+        return findObjectImpl(id);
     }
 
+    Object& getObject(ObjectId id)
+    {
+        auto objPtr = findObjectImpl(id);
+        assert(objPtr);
+        return *objPtr;
+    }
+
+    // resolves ObjectId::index of a live object, as stored in World cells
+    Object& getObjectByHandle(std::uint32_t handle)
+    {
+        assert(handle < m_handles.size());
+        auto slot = m_handles[handle].m_slot;
+        assert(slot != NoIndex);
+        return objectAt(slot);
+    }
+
+    // erased objects stay in place until mergeErasedObjectsLists()
     void eraseObject(Object& obj, ThrdIdx threadIdx)
     {
         assert(threadIdx < MaxThreads);
+        assert(!obj.m_isFree);
 
-        auto idx = obj.m_id.f.index;
-        assert(idx < m_arr.size());
-        m_freeLists[threadIdx].push_front(idx);
+        m_freeCaches[threadIdx].push_back(obj.m_slot);
         obj.m_isFree = true;
     }
 
     void mergeErasedObjectsLists()
     {
-        for (auto& lst : m_freeLists)
-            m_free.splice(m_free.end(), lst);
+        for (auto& cache : m_freeCaches)
+        {
+            for (auto slot : cache)
+            {
+                auto& obj = objectAt(slot);
+                auto handle = obj.m_id.f.index;
+                obj.~Object();
+                freeHandle(handle);
+                freeSlot(slot);
+                --m_liveCount;
+            }
+
+            cache.clear();
+        }
     }
 
-    template<typename F>
-    void parallel_for_each(F&& f)
+    unsigned liveCount() const { return m_liveCount; }
+    unsigned slotsCount() const { return m_slotsCount; }
+
+    // Moves objects from the end of the table into the free slots below them,
+    // so live objects occupy [0, liveCount()), and releases the emptied chunks.
+    // Invalidates Object references; must be called between ticks.
+    void compact()
     {
-        assert(m_threadsCount == 1);
-        auto n = m_arr.size();
-        if (n <= ThreadBlockSize)
+        assert(freeCachesEmpty() && "call mergeErasedObjectsLists() first");
+
+        auto dst = 0u, src = m_slotsCount;
+        for (;;)
         {
-            for_idx(0, n, f, 0);
-            return;
+            while (dst < src && m_slotHandle[dst] != NoIndex)
+                ++dst;
+
+            while (src > dst && m_slotHandle[src - 1] == NoIndex)
+                --src;
+
+            if (src <= dst)
+                break;
+
+            moveObject(--src, dst);
+        }
+
+        assert(dst == m_liveCount);
+        m_slotsCount = m_liveCount;
+        m_freeSlots = NoIndex;
+        m_slotHandle.resize(m_slotsCount);
+        m_columns.resize(m_slotsCount);
+        m_chunks.resize((m_slotsCount + ObjectsChunkSize - 1) / ObjectsChunkSize);
+    }
+
+    // compacts when less than half of the used slots hold live objects
+    void compactIfSparse()
+    {
+        if (m_slotsCount > ObjectsChunkSize && m_liveCount < m_slotsCount / 2)
+            compact();
+    }
+
+    // Active sets: only objects with a pending action, or with a health
+    // change or erased flag raised during the tick, are visited by the
+    // corresponding update phase.
+    void markHasAction(ObjectAPI& obj)
+    {
+        if (!obj.m_inActionList)
+        {
+            obj.m_inActionList = true;
+            m_actionList.push_back(obj.m_id);
         }
+    }
 
-        std::atomic<unsigned> nextBlockBase{0};
+    void markChanged(ObjectAPI& obj, ThrdIdx threadIdx)
+    {
+        assert(threadIdx < MaxThreads);
+        m_changedLists[threadIdx].push_back(obj.m_id);
+    }
 
-        auto&& threadFn = [&](unsigned threadIdx)
+    void mergeChangedLists()
+    {
+        for (auto& lst : m_changedLists)
         {
-            for (;;)
+            for (auto&& id : lst)
             {
-                auto blockBase = nextBlockBase.fetch_add(ThreadBlockSize);
-                if (blockBase >= n)
-                    return;
-
-                for_idx(blockBase, ThreadBlockSize, f, threadIdx);
+                auto objPtr = findObjectImpl(id);
+                if (objPtr && !objPtr->m_inChangedList)
+                {
+                    objPtr->m_inChangedList = true;
+                    m_changedList.push_back(id);
+                }
             }
-        };
 
-        std::vector<std::thread> threads;
-        for (auto threadIdx = 1u; threadIdx < m_threadsCount; ++threadIdx)
-            threads.emplace_back(threadFn, threadIdx);
+            lst.clear();
+        }
+    }
+
+    template<typename F>
+    void parallel_for_each_with_action(F&& f)
+    {
+        for_each_listed(m_actionList, &TableBase::m_inActionList, f);
+    }
+
+    template<typename F>
+    void parallel_for_each_changed(F&& f)
+    {
+        for_each_listed(m_changedList, &TableBase::m_inChangedList, f);
+    }
 
-        threadFn(0);
+    template<typename F>
+    void parallel_for_each(F&& f)
+    {
+        parallel_for(m_slotsCount, [&](unsigned base, unsigned count, ThrdIdx threadIdx)
+        {
+            for_idx(base, count, f, threadIdx);
+        });
+    }
 
-        for (auto&& th : threads)
-            th.join();
+    // calls `f` for each of `ids` that still refers to a live object
+    template<typename F>
+    void parallel_for_each(const std::vector<ObjectId>& ids, F&& f)
+    {
+        parallel_for(static_cast<unsigned>(ids.size()), [&](unsigned base, unsigned count, ThrdIdx threadIdx)
+        {
+            for (auto it = begin(ids) + base, E = it + count; it != E; ++it)
+            {
+                if (auto objPtr = findObjectImpl(*it))
+                    f(*objPtr, threadIdx);
+            }
+        });
     }
 
+    const WorkerStatsArray& workerStats() const { return m_scheduler.stats(); }
+    void resetWorkerStats() { m_scheduler.resetStats(); }
+    unsigned threadsCount() const { return m_workers.threadsCount(); }
+
     template<typename F>
     void for_each(F&& f)
     {
-        for_idx(0, m_arr.size(), f);
+        for_idx(0, m_slotsCount, f);
     }
 
 private:
+    enum : unsigned { NoIndex = ~0u };
+
+    struct Handle
+    {
+        unsigned m_slot{NoIndex};
+        unsigned m_nextFree{NoIndex};
+        std::uint8_t m_version{0};
+    };
+
+    struct Chunk
+    {
+        typename std::aligned_storage<sizeof(Object), alignof(Object)>::type m_slots[ObjectsChunkSize];
+    };
+
+    bool freeCachesEmpty() const
+    {
+        return std::all_of(m_freeCaches.begin(), m_freeCaches.end(),
+            [](const std::vector<unsigned>& cache) { return cache.empty(); });
+    }
+
+    void* slotPtr(unsigned slot)
+    {
+        return &m_chunks[slot / ObjectsChunkSize]->m_slots[slot % ObjectsChunkSize];
+    }
+
+    Object& objectAt(unsigned slot)
+    {
+        return *static_cast<Object*>(slotPtr(slot));
+    }
+
+    Object* findObjectImpl(ObjectId id)
+    {
+        auto handle = id.f.index;
+        if (handle >= m_handles.size())
+            return nullptr;
+
+        auto slot = m_handles[handle].m_slot;
+        if (slot == NoIndex)
+            return nullptr;
+
+        auto&& obj = objectAt(slot);
+        return (!obj.m_isFree && obj.m_id == id) ? &obj : nullptr;
+    }
+
+    unsigned allocHandle()
+    {
+        if (m_freeHandlesHead == NoIndex)
+        {
+            m_handles.emplace_back();
+            return static_cast<unsigned>(m_handles.size() - 1);
+        }
+
+        auto handle = m_freeHandlesHead;
+        m_freeHandlesHead = m_handles[handle].m_nextFree;
+        if (m_freeHandlesHead == NoIndex)
+            m_freeHandlesTail = NoIndex;
+        return handle;
+    }
+
+    // handles are reused in FIFO order to keep stale ids stale for long
+    void freeHandle(unsigned handle)
+    {
+        auto& h = m_handles[handle];
+        h.m_slot = NoIndex;
+        h.m_nextFree = NoIndex;
+        ++h.m_version;
+
+        if (m_freeHandlesTail == NoIndex)
+            m_freeHandlesHead = handle;
+        else
+            m_handles[m_freeHandlesTail].m_nextFree = handle;
+        m_freeHandlesTail = handle;
+    }
+
+    // a free slot stores the index of the next free slot in its own storage
+    unsigned allocSlot()
+    {
+        if (m_freeSlots != NoIndex)
+        {
+            auto slot = m_freeSlots;
+            m_freeSlots = *static_cast<unsigned*>(slotPtr(slot));
+            return slot;
+        }
+
+        auto slot = m_slotsCount++;
+        if (slot / ObjectsChunkSize == m_chunks.size())
+            m_chunks.push_back(std::make_unique<Chunk>());
+
+        m_slotHandle.push_back(NoIndex);
+        m_columns.push_back();
+        return slot;
+    }
+
+    void freeSlot(unsigned slot)
+    {
+        m_slotHandle[slot] = NoIndex;
+        new (slotPtr(slot)) unsigned{m_freeSlots};
+        m_freeSlots = slot;
+    }
+
+    void moveObject(unsigned from, unsigned to)
+    {
+        auto& obj = objectAt(from);
+        auto handle = obj.m_id.f.index;
+
+        auto moved = new (slotPtr(to)) Object(std::move(obj));
+        moved->m_slot = to;
+        obj.~Object();
+
+        m_columns.move(from, to);
+        m_handles[handle].m_slot = to;
+        m_slotHandle[to] = handle;
+        m_slotHandle[from] = NoIndex;
+    }
+
+    template<typename F>
+    void for_each_listed(std::vector<ObjectId>& ids, bool TableBase::* listFlag, F&& f)
+    {
+        parallel_for_each(ids, [&](Object& obj, ThrdIdx threadIdx)
+        {
+            obj.*listFlag = false;
+            f(obj, threadIdx);
+        });
+
+        ids.clear();
+    }
+
+    template<typename F>
+    void parallel_for(unsigned n, F&& blockFn)
+    {
+        if (n <= ThreadBlockSize || m_workers.threadsCount() == 1)
+        {
+            blockFn(0, n, 0);
+            return;
+        }
+
+        m_scheduler.run(m_workers, n, blockFn);
+    }
+
     template<typename F, typename... Ts>
     void for_idx(unsigned base, unsigned n, F&& f, Ts&&... ts)
     {
-        auto lastIdx = base + n;
-        if (lastIdx > m_arr.size()) lastIdx = m_arr.size();
+        auto lastSlot = base + n;
+        if (lastSlot > m_slotsCount) lastSlot = m_slotsCount;
 
-        for (auto it = begin(m_arr) + base, E = begin(m_arr) + lastIdx; it != E; ++it)
+        for (auto slot = base; slot != lastSlot; ++slot)
         {
-            if (!it->m_isFree)
-                f(*it, ts...);
+            if (m_slotHandle[slot] == NoIndex)
+                continue;
+
+            auto& obj = objectAt(slot);
+            if (!obj.m_isFree)
+                f(obj, ts...);
         }
     }
 
-    std::deque<Object> m_arr;
-    std::array<std::list<unsigned>, MaxThreads> m_freeLists;
-    std::list<unsigned> m_free;
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    unsigned m_slotsCount{0};
+    unsigned m_liveCount{0};
+    unsigned m_freeSlots{NoIndex};
+    std::vector<unsigned> m_slotHandle; // NoIndex for free slots
+    ObjectColumns m_columns;
+
+    std::vector<Handle> m_handles;
+    unsigned m_freeHandlesHead{NoIndex};
+    unsigned m_freeHandlesTail{NoIndex};
+
+    std::array<std::vector<unsigned>, MaxThreads> m_freeCaches;
+
+    std::vector<ObjectId> m_actionList;
+    std::array<std::vector<ObjectId>, MaxThreads> m_changedLists;
+    std::vector<ObjectId> m_changedList;
 
-    unsigned m_threadsCount;
+    WorkerPool m_workers;
+    BlockScheduler m_scheduler;
 };
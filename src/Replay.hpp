@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Game.hpp"
+#include "InputJournal.hpp"
+#include "TickProfiler.hpp"
+
+inline std::uint64_t hashMix(std::uint64_t h, std::uint64_t value)
+{
+    // splitmix64 finalizer over the running hash
+    h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+inline std::uint64_t hashPoint(const Point& pt)
+{
+    return static_cast<std::uint32_t>(pt.x) | std::uint64_t{static_cast<std::uint32_t>(pt.y)} << 32;
+}
+
+// Event sink of a replayed player. Every event is hashed together with the
+// tick it happened in and the sum is kept, so the digest doesn't depend on the
+// order in which worker threads deliver the events of one tick. Other players
+// are identified by their join order, not by their ObjectIds, which may be
+// allocated differently from run to run.
+class ReplayClient : public EventHandler
+{
+public:
+    using PlayerIds = std::unordered_map<std::uint64_t, std::uint32_t>;
+
+    ReplayClient(const Game& game, PlayerIds& playerIds, std::uint32_t player)
+        : m_game(game), m_playerIds(playerIds), m_player{player}
+    {}
+
+    ObjectId id() const { return m_id; }
+    std::uint32_t player() const { return m_player; }
+    std::uint64_t digest() const { return m_digest; }
+    std::uint64_t eventsCount() const { return m_eventsCount; }
+
+private:
+    enum class Event : std::uint8_t
+    {
+        Init, SeePlayer, Disconnect, SeeDisappear, SeeBeginMove, SeeCrossCellBorder,
+        SeeStop, SeeBeginCast, SeeEndCast, SeeEffect, HealthChange,
+    };
+
+    std::uint64_t player(ObjectId id) const
+    {
+        auto it = m_playerIds.find(id.value);
+        return it != m_playerIds.end() ? it->second : ~std::uint64_t{0};
+    }
+
+    void add(Event event, std::uint64_t a = 0, std::uint64_t b = 0, std::uint64_t c = 0)
+    {
+        auto h = hashMix(hashMix(hashMix(hashMix(m_game.now(), static_cast<std::uint64_t>(event)), a), b), c);
+        m_digest.fetch_add(h, std::memory_order_relaxed);
+        m_eventsCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    virtual void init(const InitInfo& info) override
+    {
+        m_id = info.m_id;
+        m_playerIds[m_id.value] = m_player;
+        add(Event::Init, hashPoint(info.m_pos), static_cast<std::uint64_t>(info.m_health));
+    }
+
+    virtual void seePlayer(const FullPlayerInfo& info) override
+    {
+        auto state = static_cast<std::uint64_t>(info.m_state) | static_cast<std::uint64_t>(info.m_moveDir) << 8
+            | static_cast<std::uint64_t>(info.m_spell) << 16;
+        add(Event::SeePlayer, player(info.m_id), hashPoint(info.m_pos), state);
+    }
+
+    virtual void disconnect() override { add(Event::Disconnect); }
+    virtual void seeDisappear(ObjectId id) override { add(Event::SeeDisappear, player(id)); }
+
+    virtual void seeBeginMove(const MoveInfo& info) override
+    {
+        add(Event::SeeBeginMove, player(info.id), static_cast<std::uint64_t>(info.moveDir));
+    }
+
+    virtual void seeCrossCellBorder(ObjectId id) override { add(Event::SeeCrossCellBorder, player(id)); }
+    virtual void seeStop(ObjectId id) override { add(Event::SeeStop, player(id)); }
+
+    virtual void seeBeginCast(const CastInfo& info) override
+    {
+        add(Event::SeeBeginCast, player(info.m_id), static_cast<std::uint64_t>(info.m_spell));
+    }
+
+    virtual void seeEndCast(ObjectId id) override { add(Event::SeeEndCast, player(id)); }
+
+    virtual void seeEffect(const SpellEffect& effect) override
+    {
+        add(Event::SeeEffect, hashPoint(effect.m_pos), static_cast<std::uint64_t>(effect.m_effect));
+    }
+
+    virtual void healthChange(int newHP) override
+    {
+        add(Event::HealthChange, static_cast<std::uint64_t>(newHP));
+    }
+
+    const Game& m_game;
+    PlayerIds& m_playerIds;
+    std::uint32_t m_player;
+    ObjectId m_id;
+    std::atomic<std::uint64_t> m_digest{0};
+    std::atomic<std::uint64_t> m_eventsCount{0};
+};
+
+// Feeds a journal into a fresh Game as fast as it can tick: the records of
+// tick T are applied while Game::now() is T, before the tick that handles them.
+class Replay
+{
+public:
+    // `cfg` gives threadsCount and compactObjects, the rest comes from the journal
+    Replay(JournalReader& journal, const GameCfg& cfg)
+        : m_journal(journal)
+        , m_cfg{cfg}
+    {
+        m_journal.loadCfg(m_cfg);
+        m_game = std::make_unique<Game>(m_cfg);
+        if (m_journal.hasMap())
+            m_game->m_geodata.loadWalls(m_journal.map());
+
+        m_hasNext = m_journal.next(m_next);
+    }
+
+    // returns false on a truncated or malformed journal;
+    // `drainTicks` more ticks after the last record let pending timers fire
+    bool run(unsigned drainTicks)
+    {
+        while (hasRecords())
+        {
+            if (!step())
+                return false;
+        }
+
+        for (auto n = 0u; n != drainTicks; ++n)
+            step();
+
+        return m_journal.atEnd();
+    }
+
+    // applies the records of the current tick and runs it; false on a bad record
+    bool step()
+    {
+        for (; m_hasNext && m_next.m_tick == m_game->now(); m_hasNext = m_journal.next(m_next))
+        {
+            if (!apply(m_next))
+                return false;
+        }
+
+        tick();
+        return true;
+    }
+
+    bool hasRecords() const { return m_hasNext; }
+
+    // combines the players' digests in join order
+    std::uint64_t digest() const
+    {
+        std::uint64_t h = m_clients.size();
+        for (auto&& client : m_clients)
+            h = h * 0x100000001b3ull ^ client->digest();
+        return h;
+    }
+
+    // Hash of each live player's object and of its cells in the World, indexed
+    // by join order; zero for players that are gone.
+    void stateDigests(std::vector<std::uint64_t>& digests)
+    {
+        digests.assign(m_clients.size(), 0);
+        m_game->forEachObject([&](const Object& obj)
+        {
+            auto player = static_cast<const ReplayClient*>(obj.m_eventHandler)->player();
+            auto h = hashMix(hashMix(player, hashPoint(obj.pos())), hashPoint(obj.m_castDest));
+            h = hashMix(h, static_cast<std::uint64_t>(obj.state()) | static_cast<std::uint64_t>(obj.moveDir()) << 8
+                | static_cast<std::uint64_t>(obj.m_spell) << 16 | static_cast<std::uint64_t>(obj.m_timerAction) << 24
+                | std::uint64_t{obj.m_erased} << 32);
+            h = hashMix(h, obj.timerDeadline());
+            h = hashMix(h, static_cast<std::uint32_t>(obj.m_health));
+
+            // the World must point back at the object, and a mover holds its destination
+            h = hashMix(h, m_game->cellObject(obj.pos()) == &obj);
+            if (obj.state() == PlayerState::MovingOut)
+                h = hashMix(h, m_game->isCellFree(obj.moveDest()));
+
+            digests[player] = h;
+        });
+    }
+
+    // Hash of the World's allocated chunks in chunk order: every cell's flags
+    // and the join order of the player that occupies or has locked it.
+    std::uint64_t worldDigest()
+    {
+        std::uint64_t h = 0;
+        m_game->forEachWorldCell([&](std::size_t ci, const Point& pt, std::uint32_t flags, const Object* holder)
+        {
+            auto player = holder ? static_cast<const ReplayClient*>(holder->m_eventHandler)->player() + 1 : 0;
+            h = hashMix(hashMix(hashMix(h, ci), hashPoint(pt)), flags | std::uint64_t{player} << 32);
+        });
+        return h;
+    }
+
+    std::uint64_t eventsCount() const
+    {
+        std::uint64_t n = 0;
+        for (auto&& client : m_clients)
+            n += client->eventsCount();
+        return n;
+    }
+
+    std::size_t playersCount() const { return m_clients.size(); }
+    const ReplayClient& client(std::uint32_t player) const { return *m_clients[player]; }
+    ticks_t ticksCount() const { return m_game->now(); }
+    const LatencyHistogram& tickNs() const { return m_tickNs; }
+    Game& game() { return *m_game; }
+
+private:
+    bool apply(const JournalEntry& entry)
+    {
+        switch (entry.m_kind)
+        {
+        case JournalEntry::Kind::NewPlayer:
+            if (entry.m_player != m_clients.size())
+                return false;
+
+            m_clients.push_back(std::make_unique<ReplayClient>(*m_game, m_playerIds, entry.m_player));
+            m_game->newPlayer(*m_clients.back(), entry.m_pos, entry.m_name);
+            return true;
+
+        case JournalEntry::Kind::Action:
+            if (entry.m_player >= m_clients.size())
+                return false;
+
+            m_game->enqueueAction(m_clients[entry.m_player]->id(), entry.m_action);
+            return true;
+        }
+
+        return false;
+    }
+
+    void tick()
+    {
+        auto start = TickProfiler::Clock::now();
+        m_game->tick();
+        m_tickNs.record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(TickProfiler::Clock::now() - start).count()));
+    }
+
+    JournalReader& m_journal;
+    GameCfg m_cfg;
+    std::unique_ptr<Game> m_game;
+    ReplayClient::PlayerIds m_playerIds;
+    std::vector<std::unique_ptr<ReplayClient>> m_clients;
+    LatencyHistogram m_tickNs;
+
+    JournalEntry m_next;
+    bool m_hasNext{false};
+};
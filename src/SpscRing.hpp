@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Each side caches the other side's index and only reloads it when
+// the ring looks full (producer) or empty (consumer).
+template<typename T, std::size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    void operator=(const SpscRing&) = delete;
+
+    // producer side; returns false if the ring is full
+    bool push(T&& value)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache == Capacity)
+        {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache == Capacity)
+                return false;
+        }
+
+        m_items[tail & Mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer side; at least this many pushes will succeed
+    std::size_t freeSpace() const
+    {
+        return Capacity - (m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire));
+    }
+
+    // consumer side; returns false if the ring is empty
+    bool pop(T& value)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache)
+        {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache)
+                return false;
+        }
+
+        value = std::move(m_items[head & Mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static const std::size_t Mask = Capacity - 1;
+
+    std::array<T, Capacity> m_items;
+
+    alignas(64) std::atomic<std::size_t> m_head{0}; // written by the consumer
+    std::size_t m_tailCache{0};
+
+    alignas(64) std::atomic<std::size_t> m_tail{0}; // written by the producer
+    std::size_t m_headCache{0};
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+#if defined _MSC_VER
+#   include <intrin.h>
+#endif
+
+// Log-linear latency histogram in the spirit of HdrHistogram: values below 32
+// are exact, larger ones land in one of 16 sub-buckets per power of two, so
+// any reported percentile is within 1/16 of the recorded value.
+class LatencyHistogram
+{
+public:
+    static const auto SubBucketBits = 4;
+    static const auto SubBuckets = 1u << SubBucketBits;
+    static const auto BucketsCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+    LatencyHistogram() { reset(); }
+
+    void record(std::uint64_t value)
+    {
+        ++m_counts[bucketOf(value)];
+        ++m_total;
+        if (value > m_max)
+            m_max = value;
+    }
+
+    void reset()
+    {
+        m_counts.fill(0);
+        m_total = 0;
+        m_max = 0;
+    }
+
+    std::uint64_t count() const { return m_total; }
+    std::uint64_t max() const { return m_max; }
+
+    // upper bound of the bucket holding the `p`-th percentile, p in [0, 100]
+    std::uint64_t percentile(double p) const
+    {
+        if (m_total == 0)
+            return 0;
+
+        auto rank = static_cast<std::uint64_t>(p / 100 * m_total + 0.5);
+        if (rank == 0)
+            rank = 1;
+
+        std::uint64_t seen = 0;
+        for (auto idx = 0u; idx != BucketsCount; ++idx)
+        {
+            seen += m_counts[idx];
+            if (seen >= rank)
+                return std::min(highestInBucket(idx), m_max);
+        }
+
+        return m_max;
+    }
+
+    static unsigned bucketOf(std::uint64_t value)
+    {
+        if (value < 2 * SubBuckets)
+            return static_cast<unsigned>(value);
+
+        auto exp = highestBit(value);
+        auto sub = static_cast<unsigned>(value >> (exp - SubBucketBits)) - SubBuckets;
+        return (exp - SubBucketBits + 1) * SubBuckets + sub;
+    }
+
+    static std::uint64_t highestInBucket(unsigned idx)
+    {
+        if (idx < 2 * SubBuckets)
+            return idx;
+
+        auto exp = idx / SubBuckets + SubBucketBits - 1;
+        auto sub = idx % SubBuckets;
+        auto width = std::uint64_t{1} << (exp - SubBucketBits);
+        return (SubBuckets + sub) * width + width - 1;
+    }
+
+private:
+    static unsigned highestBit(std::uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanReverse64(&idx, value);
+        return static_cast<unsigned>(idx);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    std::array<std::uint32_t, BucketsCount> m_counts;
+    std::uint64_t m_total;
+    std::uint64_t m_max;
+};
+
+enum class TickPhase
+{
+    Actions,            // dispatching queued player actions
+    Timers,             // expiring the timer wheel and running timer actions
+    Changed,            // health updates and erasing disconnected objects
+    MergeErased,        // mergeErasedObjectsLists and merging staged timers
+    PollConnections,    // draining the network thread's inbound ring
+    Flush,              // flushing connections and handing frames to the network thread
+    Tick,               // the whole Server::tick
+    Count
+};
+
+inline const char* phaseName(TickPhase phase)
+{
+    switch (phase)
+    {
+    case TickPhase::Actions: return "actions";
+    case TickPhase::Timers: return "timers";
+    case TickPhase::Changed: return "changed";
+    case TickPhase::MergeErased: return "merge_erased";
+    case TickPhase::PollConnections: return "poll_connections";
+    case TickPhase::Flush: return "flush";
+    case TickPhase::Tick: return "tick";
+    case TickPhase::Count: break;
+    }
+
+    assert(!"unknown tick phase");
+    return "?";
+}
+
+// Per-phase tick latencies in nanoseconds. Phases are timed on the main
+// thread only; a parallel phase is measured as a whole.
+class TickProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Scope
+    {
+    public:
+        Scope(TickProfiler& profiler, TickPhase phase)
+            : m_profiler(profiler), m_phase{phase}, m_start{Clock::now()}
+        {}
+
+        Scope(const Scope&) = delete;
+        void operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+            m_profiler.record(m_phase, static_cast<std::uint64_t>(ns));
+        }
+
+    private:
+        TickProfiler& m_profiler;
+        TickPhase m_phase;
+        Clock::time_point m_start;
+    };
+
+    void record(TickPhase phase, std::uint64_t ns)
+    {
+        m_phases[static_cast<unsigned>(phase)].record(ns);
+    }
+
+    const LatencyHistogram& histogram(TickPhase phase) const
+    {
+        return m_phases[static_cast<unsigned>(phase)];
+    }
+
+    void reset()
+    {
+        for (auto&& h : m_phases)
+            h.reset();
+    }
+
+    // one line per phase, in microseconds
+    void print(std::ostream& os) const
+    {
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << std::left << std::setw(18) << "phase" << std::right
+            << std::setw(10) << "count"
+            << std::setw(10) << "p50 us"
+            << std::setw(10) << "p99 us"
+            << std::setw(10) << "max us" << '\n';
+
+        os << std::fixed << std::setprecision(1);
+        for (auto i = 0u; i != m_phases.size(); ++i)
+        {
+            auto& h = m_phases[i];
+            os << std::left << std::setw(18) << phaseName(static_cast<TickPhase>(i)) << std::right
+                << std::setw(10) << h.count()
+                << std::setw(10) << h.percentile(50) / 1000.0
+                << std::setw(10) << h.percentile(99) / 1000.0
+                << std::setw(10) << h.max() / 1000.0 << '\n';
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+private:
+    std::array<LatencyHistogram, static_cast<unsigned>(TickPhase::Count)> m_phases;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Fixed-rate tick scheduler. Deadlines are `start + n * period`, so the time
+// spent in a tick never shifts the following ones. When the loop falls
+// behind, the missed ticks are run back to back, at most `maxCatchUp` at once;
+// the rest are dropped and the schedule is rebased to the current time.
+class TickScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TickScheduler(int ticksPerSecond, int maxCatchUp)
+        : m_period{std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / ticksPerSecond}
+        , m_maxCatchUp{static_cast<unsigned>(maxCatchUp)}
+    {
+        assert(ticksPerSecond > 0);
+        assert(maxCatchUp > 0);
+    }
+
+    void start() { start(Clock::now()); }
+
+    void start(Clock::time_point now)
+    {
+        m_nextTick = now;
+    }
+
+    // sleeps until the next deadline, returns how many ticks to run now
+    unsigned waitForTicks()
+    {
+        auto now = Clock::now();
+        if (now < m_nextTick)
+        {
+            std::this_thread::sleep_until(m_nextTick);
+            return advance(Clock::now(), false);
+        }
+
+        return advance(now, m_ticks != 0);
+    }
+
+    // non-blocking variant: zero if the next deadline is still ahead of `now`
+    unsigned dueTicks(Clock::time_point now)
+    {
+        if (now < m_nextTick)
+            return 0;
+
+        return advance(now, m_ticks != 0 && now > m_nextTick);
+    }
+
+    Clock::duration period() const { return m_period; }
+    Clock::time_point nextTick() const { return m_nextTick; }
+
+    std::uint64_t ticks() const { return m_ticks; }
+    std::uint64_t overruns() const { return m_overruns; }
+    std::uint64_t skipped() const { return m_skipped; }
+
+private:
+    unsigned advance(Clock::time_point now, bool overran)
+    {
+        // the previous tick was still running when this one became due
+        if (overran)
+            ++m_overruns;
+
+        auto due = 1 + static_cast<std::uint64_t>((now - m_nextTick) / m_period);
+        if (due > m_maxCatchUp)
+        {
+            m_skipped += due - m_maxCatchUp;
+            due = m_maxCatchUp;
+            m_nextTick = now + m_period;
+        }
+        else
+        {
+            m_nextTick += m_period * due;
+        }
+
+        m_ticks += due;
+        return static_cast<unsigned>(due);
+    }
+
+    Clock::duration m_period;
+    unsigned m_maxCatchUp;
+    Clock::time_point m_nextTick;
+
+    std::uint64_t m_ticks{0};
+    std::uint64_t m_overruns{0};
+    std::uint64_t m_skipped{0};
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "build_config.hpp"
+#include "types.hpp"
+
+// Hashed timer wheel: a timer lands in slot `deadline % WheelSize`, and each
+// tick only the slot of the current tick is inspected. Timers are set from the
+// parallel phases, so they go to per-thread staging lists first and are moved
+// into the wheel by mergeStaged() between phases.
+// Slots are chains of nodes from a pooled free list, so once the pool and the
+// staging lists have grown to the peak number of timers nothing is allocated.
+class TimerWheel
+{
+public:
+    static const auto WheelSize = 256u;
+
+    TimerWheel()
+    {
+        m_slots.fill(unsigned{NoNode});
+    }
+
+    void add(ObjectId id, ticks_t deadline, ThrdIdx threadIdx)
+    {
+        assert(threadIdx < MaxThreads);
+        m_staged[threadIdx].push_back({id, deadline, NoNode});
+    }
+
+    void mergeStaged()
+    {
+        for (auto& lst : m_staged)
+        {
+            for (auto&& timer : lst)
+            {
+                auto nodeIdx = allocNode();
+                auto& head = slot(timer.m_deadline);
+                m_nodes[nodeIdx] = timer;
+                m_nodes[nodeIdx].m_next = head;
+                head = nodeIdx;
+            }
+
+            lst.clear();
+        }
+    }
+
+    // appends ids of the timers expiring at `now` to `due`
+    void expire(ticks_t now, std::vector<ObjectId>& due)
+    {
+        auto link = &slot(now);
+        while (*link != NoNode)
+        {
+            auto nodeIdx = *link;
+            auto& node = m_nodes[nodeIdx];
+            if (static_cast<std::int32_t>(node.m_deadline - now) <= 0)
+            {
+                due.push_back(node.m_id);
+                *link = node.m_next;
+                node.m_next = m_freeNodes;
+                m_freeNodes = nodeIdx;
+            }
+            else
+            {
+                link = &node.m_next;
+            }
+        }
+    }
+
+private:
+    static const auto NoNode = ~0u;
+
+    struct Node
+    {
+        ObjectId m_id;
+        ticks_t m_deadline;
+        unsigned m_next;
+    };
+
+    unsigned allocNode()
+    {
+        if (m_freeNodes == NoNode)
+        {
+            m_nodes.emplace_back();
+            return static_cast<unsigned>(m_nodes.size() - 1);
+        }
+
+        auto nodeIdx = m_freeNodes;
+        m_freeNodes = m_nodes[nodeIdx].m_next;
+        return nodeIdx;
+    }
+
+    unsigned& slot(ticks_t t) { return m_slots[t % WheelSize]; }
+
+    std::array<unsigned, WheelSize> m_slots;
+    std::vector<Node> m_nodes;
+    unsigned m_freeNodes{NoNode};
+
+    std::array<std::vector<Node>, MaxThreads> m_staged;
+};
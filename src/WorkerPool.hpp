@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cassert>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "build_config.hpp"
+#include "types.hpp"
+
+// Long-lived worker threads for the parallel tick phases.
+// The calling thread is worker 0, so `threadsCount - 1` threads are started.
+// Between jobs the workers spin for a short while and then park on a
+// condition variable; run() only touches the mutex when somebody is parked.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned threadsCount) : m_threadsCount{threadsCount}
+    {
+        assert(threadsCount >= 1 && threadsCount <= MaxThreads);
+
+        for (auto threadIdx = 1u; threadIdx < m_threadsCount; ++threadIdx)
+            m_threads.emplace_back([this, threadIdx]{ workerMain(threadIdx); });
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    void operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool()
+    {
+        m_stopRequested = true;
+        wakeUpWorkers();
+
+        for (auto&& th : m_threads)
+            th.join();
+    }
+
+    unsigned threadsCount() const { return m_threadsCount; }
+
+    // calls `f(threadIdx)` once on every worker and returns when all calls are done
+    template<typename F>
+    void run(F&& f)
+    {
+        if (m_threadsCount == 1)
+        {
+            f(ThrdIdx{0});
+            return;
+        }
+
+        m_job = &callJob<std::remove_reference_t<F>>;
+        m_jobCtx = &f;
+        m_pending.store(m_threadsCount - 1, std::memory_order_relaxed);
+        wakeUpWorkers();
+
+        f(ThrdIdx{0});
+
+        while (m_pending.load(std::memory_order_acquire) != 0)
+            std::this_thread::yield();
+    }
+
+private:
+    static const auto SpinCount = 4096;
+
+    template<typename F>
+    static void callJob(void* ctx, ThrdIdx threadIdx)
+    {
+        (*static_cast<F*>(ctx))(threadIdx);
+    }
+
+    void wakeUpWorkers()
+    {
+        m_generation.fetch_add(1);
+
+        if (m_parkedCount.load() != 0)
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_wakeUp.notify_all();
+        }
+    }
+
+    unsigned waitForJob(unsigned seenGeneration)
+    {
+        for (auto n = 0; n != SpinCount; ++n)
+        {
+            auto gen = m_generation.load();
+            if (gen != seenGeneration)
+                return gen;
+
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        ++m_parkedCount;
+        m_wakeUp.wait(lock, [&]{ return m_generation.load() != seenGeneration; });
+        --m_parkedCount;
+        return m_generation.load();
+    }
+
+    void workerMain(ThrdIdx threadIdx)
+    {
+        auto seenGeneration = 0u;
+        for (;;)
+        {
+            seenGeneration = waitForJob(seenGeneration);
+            if (m_stopRequested)
+                return;
+
+            m_job(m_jobCtx, threadIdx);
+            m_pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    unsigned m_threadsCount;
+    std::vector<std::thread> m_threads;
+
+    void (*m_job)(void*, ThrdIdx){nullptr};
+    void* m_jobCtx{nullptr};
+
+    std::atomic<unsigned> m_generation{0};
+    std::atomic<unsigned> m_pending{0};
+    std::atomic<unsigned> m_parkedCount{0};
+    std::atomic<bool> m_stopRequested{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+};
@@ -1,72 +1,462 @@
 #pragma once
 
 #include <cassert>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "build_config.hpp"
 #include "types.hpp"
 #include "math.hpp"
 
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+// Cells of the world: walls, world edges and object occupancy fused into one
+// 8-byte record. Besides its own state a cell caches which of its neighbours
+// are occupied, so "can an object move from here in that direction" is one
+// load and a mask test. An occupied cell holds a 32-bit object handle
+// (ObjectId::index, resolved through ObjectManager) rather than a full id.
+// Cells are stored in 64x64 chunks of 8x8 tiles, so a view-radius
+// neighbourhood touches only a few contiguous 512-byte blocks.
+//
+// Chunks are allocated on the first wall or occupancy written into them.
+// Untouched chunks point at a shared read-only template page (zero cells plus
+// the world-edge bits of their position), and a chunk whose last occupant
+// leaves goes back to its template in releaseEmptyChunks(), so memory follows
+// the populated area rather than the map bounds.
+//
+// Parallel tick phases write neighbouring cells from several workers, so cell
+// flags only change through atomic read-modify-writes, and a cell is locked
+// for a move with a compare-and-swap that fails if another worker took it.
+// Chunk references are atomic too; chunks are allocated under a mutex and
+// only freed between ticks, so a worker never sees a chunk go away.
 class World
 {
 public:
+    using Handle = std::uint32_t;
+    static const Handle NoObject = ~0u;
+
     explicit World(int cx, int cy)
         : m_cx(cx), m_cy(cy)
+        , m_chunksX{(cx + ChunkSize - 1) >> ChunkShift}
+        , m_chunksY{(cy + ChunkSize - 1) >> ChunkShift}
+        , m_chunks(static_cast<std::size_t>(m_chunksX) * m_chunksY)
+        , m_chunkRefs(m_chunks.size())
+    {
+        for (auto chunkY = 0; chunkY != m_chunksY; ++chunkY)
+            for (auto chunkX = 0; chunkX != m_chunksX; ++chunkX)
+                m_chunks[chunkIdx(chunkX, chunkY)] = templateFor(chunkX, chunkY);
+
+        m_spareChunks.reserve(MaxSpareChunks);
+    }
+
+    ~World()
+    {
+        for (auto ci = 0u; ci != m_chunks.size(); ++ci)
+            if (!isTemplate(ci, m_chunks[ci]))
+                delete m_chunks[ci];
+    }
+
+    World(const World&) = delete;
+    void operator=(const World&) = delete;
+
+    // returns the handle of the object in the cell, or NoObject
+    // if the cell is empty, locked or outside the world
+    Handle objectAt(const Point& pt) const
+    {
+        if (!isValidPoint(pt))
+            return NoObject;
+
+        auto&& c = cell(pt);
+        return (c.flags() & OccupiedFlag) ? c.handle() : NoObject;
+    }
+
+    bool isFree(const Point& pt) const
     {
-        m_objectTable.resize(m_cy);
-        for (auto& v : m_objectTable)
-            v.resize(cx);
+        return (cell(pt).flags() & (OccupiedFlag | LockedFlag)) == 0;
     }
 
-    ObjectId objectAt(const Point& pt) const
+    // no wall, world edge, object or lock in the way
+    bool canMove(const Point& pt, Dir moveDir) const
     {
-        return isValidPoint(pt) ? getAt(pt) : ObjectId{};
+        return (cell(pt).flags() & blockedMask(moveDir)) == 0;
     }
 
+    bool hasWall(const Point& pt, Dir moveDir) const
+    {
+        return (cell(pt).flags() & dirFlag(WallBits, moveDir)) != 0;
+    }
+
+    // blocks moves into `pt` from its neighbours
+    void addWall(const Point& pt)
+    {
+        // walls are permanent, so the references are never released
+        forNeighbours(pt, [&](const Point& n, Dir dirToPt) { acquire(n).setFlags(dirFlag(WallBits, dirToPt)); });
+    }
+
+    // Bulk addWall for map loading, written chunk by chunk. `rowBits(x, y)`
+    // returns the walls of cells [x, x + 64) in row `y`, with cells outside
+    // the world reading as no wall. Chunks without walls stay unallocated.
+    template<typename RowBits>
+    void addWalls(RowBits&& rowBits)
+    {
+        static_assert(ChunkSize == 64, "a chunk row is one 64-bit word");
+
+        for (auto chunkY = 0; chunkY != m_chunksY; ++chunkY)
+        {
+            for (auto chunkX = 0; chunkX != m_chunksX; ++chunkX)
+            {
+                auto x0 = chunkX << ChunkShift;
+                auto y0 = chunkY << ChunkShift;
+                auto columns = std::min(m_cx - x0, int{ChunkSize});
+                auto inWorld = columns == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << columns) - 1;
+                auto ci = chunkIdx(chunkX, chunkY);
+                Chunk* chunk = nullptr;
+
+                for (auto y = y0; y != std::min(y0 + ChunkSize, m_cy); ++y)
+                {
+                    // bit i: the neighbour of cell (x0 + i, y) in that direction is a wall
+                    std::uint64_t walls[DirCount];
+                    walls[static_cast<int>(Dir::Right)] = rowBits(x0 + 1, y) & inWorld;
+                    walls[static_cast<int>(Dir::Up)] = rowBits(x0, y - 1) & inWorld;
+                    walls[static_cast<int>(Dir::Left)] = rowBits(x0 - 1, y) & inWorld;
+                    walls[static_cast<int>(Dir::Down)] = rowBits(x0, y + 1) & inWorld;
+
+                    for (auto d = 0; d != DirCount; ++d)
+                    {
+                        if (walls[d] == 0)
+                            continue;
+
+                        // walls are permanent, so the chunk keeps this reference
+                        if (!chunk)
+                            chunk = acquireChunk(ci);
+
+                        auto flag = dirFlag(WallBits, static_cast<Dir>(d));
+                        for (auto bits = walls[d]; bits != 0; bits &= bits - 1)
+                            (*chunk)[idxInChunk(x0 + lowestBit(bits), y)].setFlags(flag);
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename Callback>
+    void forObjectsAround(const Point& center, int radius, Callback&& callback) const
+    {
+        auto minY = std::max(center.y - radius, 0);
+        auto maxY = std::min(center.y + radius, m_cy - 1);
+        for (auto y = minY; y <= maxY; ++y)
+        {
+            auto rx = radius - std::abs(y - center.y);
+            auto minX = std::max(center.x - rx, 0);
+            auto maxX = std::min(center.x + rx, m_cx - 1);
+
+            for (auto x = minX; x <= maxX; )
+            {
+                // walk the row one chunk span at a time
+                auto chunk = m_chunks[chunkIdx(x >> ChunkShift, y >> ChunkShift)].load(std::memory_order_acquire);
+                auto spanEnd = std::min(maxX, x | (ChunkSize - 1));
+                for (; x <= spanEnd; ++x)
+                {
+                    auto&& c = (*chunk)[idxInChunk(x, y)];
+                    if (c.flags() & OccupiedFlag)
+                        callback(c.handle());
+                }
+            }
+        }
+    }
+
+    // Calls `callback(chunkIdx, pt, flags, handle)` for every cell of the
+    // allocated chunks, in chunk order; the handle is the occupant or the lock
+    // owner, else NoObject. Called between ticks only.
+    template<typename Callback>
+    void forEachAllocatedCell(Callback&& callback) const
+    {
+        for (auto ci = std::size_t{0}; ci != m_chunks.size(); ++ci)
+        {
+            auto chunk = m_chunks[ci].load(std::memory_order_acquire);
+            if (isTemplate(ci, chunk))
+                continue;
+
+            auto x0 = static_cast<int>(ci % m_chunksX) << ChunkShift;
+            auto y0 = static_cast<int>(ci / m_chunksX) << ChunkShift;
+            for (auto y = y0; y != std::min(y0 + ChunkSize, m_cy); ++y)
+            {
+                for (auto x = x0; x != std::min(x0 + ChunkSize, m_cx); ++x)
+                {
+                    auto&& c = (*chunk)[idxInChunk(x, y)];
+                    auto flags = c.flags();
+                    callback(ci, Point{x, y}, flags, (flags & (OccupiedFlag | LockedFlag)) ? c.handle() : NoObject);
+                }
+            }
+        }
+    }
+
+    // called between ticks only
     void addObject(ObjectId id, const Point& pt)
     {
         assert(isValidPoint(pt));
-        assert(!objectAt(pt));
-        setAt(pt, id);
+        assert(isFree(pt));
+
+        // the handle is stored before the flag makes it visible to readers
+        auto&& c = acquire(pt);
+        c.m_handle.store(id.f.index, std::memory_order_relaxed);
+        c.setFlags(OccupiedFlag);
+        addNeighbourBits(pt);
     }
 
     void removeObject(const Point& pt)
     {
-        assert(objectAt(pt));
-        setAt(pt, {});
+        assert(!isFree(pt));
+        vacate(pt);
     }
 
-    void lockCell(ObjectId lockOwner, const Point& pt)
+    // false if the cell is occupied or another mover has locked it first
+    bool lockCell(ObjectId lockOwner, const Point& pt)
     {
-        addObject(makeLockId(lockOwner), pt);
+        auto&& c = acquire(pt);
+        auto flags = c.flags();
+        do
+        {
+            if (flags & (OccupiedFlag | LockedFlag))
+            {
+                release(pt);
+                return false;
+            }
+        } while (!c.m_flags.compare_exchange_weak(flags, flags | LockedFlag));
+
+        // nobody reads the handle of a locked cell but its owner
+        c.m_handle.store(lockOwner.f.index, std::memory_order_relaxed);
+        addNeighbourBits(pt);
+        return true;
     }
 
     void moveToCell(const Point& from, const Point& dest)
     {
-        assert(isLocked(dest));
-        auto id = objectAt(from);
-        assert(id == withoutReserved(objectAt(dest)));
-        removeObject(from);
-        removeObject(dest);
-        addObject(id, dest);
+        assert(cell(dest).flags() & LockedFlag);
+        assert(cell(from).handle() == cell(dest).handle());
+        vacate(from);
+
+        auto&& c = cell(dest);
+        auto flags = c.flags();
+        while (!c.m_flags.compare_exchange_weak(flags, (flags & ~LockedFlag) | OccupiedFlag))
+            ;
+    }
+
+    std::size_t memoryUsage() const
+    {
+        auto templatesCount = std::count_if(m_templates.begin(), m_templates.end(),
+            [](const std::unique_ptr<Chunk>& t) { return t != nullptr; });
+
+        return sizeof(*this)
+            + m_chunks.capacity() * sizeof(m_chunks[0])
+            + m_chunkRefs.capacity() * sizeof(m_chunkRefs[0])
+            + (m_allocatedChunks + m_spareChunks.size() + templatesCount) * sizeof(Chunk);
+    }
+
+    std::size_t allocatedChunks() const { return m_allocatedChunks; }
+
+    // Returns the chunks emptied since the last call to their templates.
+    // Must be called between ticks, when no worker holds a chunk pointer.
+    void releaseEmptyChunks()
+    {
+        for (auto ci : m_emptyChunks)
+        {
+            if (m_chunkRefs[ci] == 0 && !isTemplate(ci, m_chunks[ci]))
+            {
+                freeChunk(m_chunks[ci]);
+                m_chunks[ci] = m_templates[templateKey(ci)].get();
+            }
+        }
+
+        m_emptyChunks.clear();
     }
 
 private:
-    static const std::uint8_t CellLockFlag = 0x80;
+    static const auto TileShift = 3;
+    static const auto TileSize = 1 << TileShift;
+    static const auto ChunkShift = WorldChunkShift;
+    static const auto ChunkSize = 1 << ChunkShift;
+    static const auto MaxSpareChunks = 64u;
+
+    // per-direction flag groups, bit `Dir` within each group
+    static const auto WallBits = 0;
+    static const auto EdgeBits = 4;
+    static const auto NeighbourBits = 8;
+    static const std::uint32_t OccupiedFlag = 1 << 12;
+    static const std::uint32_t LockedFlag = 1 << 13;
 
-    static ObjectId withoutReserved(ObjectId id)
+    // copyable so chunks can be filled from their templates
+    struct Cell
     {
-        id.f.reserved = 0;
-        return id;
+        Cell() = default;
+        Cell(const Cell& other) : m_flags{other.flags()}, m_handle{other.handle()} {}
+
+        Cell& operator=(const Cell& other)
+        {
+            m_flags.store(other.flags(), std::memory_order_relaxed);
+            m_handle.store(other.handle(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        std::uint32_t flags() const { return m_flags.load(std::memory_order_acquire); }
+        Handle handle() const { return m_handle.load(std::memory_order_relaxed); }
+        void setFlags(std::uint32_t flags) { m_flags.fetch_or(flags, std::memory_order_release); }
+        void clearFlags(std::uint32_t flags) { m_flags.fetch_and(~flags, std::memory_order_release); }
+
+        std::atomic<std::uint32_t> m_flags{0};
+        std::atomic<Handle> m_handle{0};
+    };
+
+    using Chunk = std::array<Cell, ChunkSize * ChunkSize>;
+
+    // template key bits: which world edges pass through the chunk
+    enum : unsigned { LeftEdge = 1, RightEdge = 2, TopEdge = 4, BottomEdge = 8, EdgeCombinations = 16 };
+
+    static std::uint32_t dirFlag(int group, Dir dir)
+    {
+        return 1u << (group + static_cast<int>(dir));
+    }
+
+    static std::uint32_t blockedMask(Dir dir)
+    {
+        return dirFlag(WallBits, dir) | dirFlag(EdgeBits, dir) | dirFlag(NeighbourBits, dir);
+    }
+
+    // calls `f(neighbourPoint, directionFromNeighbourToPt)`
+    template<typename F>
+    void forNeighbours(const Point& pt, F&& f)
+    {
+        for (auto d = 0; d != DirCount; ++d)
+        {
+            auto dir = static_cast<Dir>(d);
+            auto neighbour = moveRel(pt, dir);
+            if (isValidPoint(neighbour))
+                f(neighbour, oppositeDir(dir));
+        }
+    }
+
+    // Every write into a chunk holds a reference to it until the write is
+    // undone; a chunk without references equals its template.
+    void addNeighbourBits(const Point& pt)
+    {
+        forNeighbours(pt, [&](const Point& n, Dir dirToPt) { acquire(n).setFlags(dirFlag(NeighbourBits, dirToPt)); });
+    }
+
+    void vacate(const Point& pt)
+    {
+        cell(pt).clearFlags(OccupiedFlag | LockedFlag);
+        release(pt);
+        forNeighbours(pt, [&](const Point& n, Dir dirToPt)
+        {
+            cell(n).clearFlags(dirFlag(NeighbourBits, dirToPt));
+            release(n);
+        });
+    }
+
+    Cell& acquire(const Point& pt)
+    {
+        acquireChunk(chunkIdx(pt.x >> ChunkShift, pt.y >> ChunkShift));
+        return cell(pt);
+    }
+
+    Chunk* acquireChunk(std::size_t ci)
+    {
+        m_chunkRefs[ci].fetch_add(1, std::memory_order_relaxed);
+        auto chunk = m_chunks[ci].load(std::memory_order_acquire);
+        if (!isTemplate(ci, chunk))
+            return chunk;
+
+        // workers that raced here for the same chunk find it allocated under the lock
+        std::lock_guard<std::mutex> lock{m_chunksMutex};
+        chunk = m_chunks[ci].load(std::memory_order_relaxed);
+        if (isTemplate(ci, chunk))
+        {
+            chunk = allocChunk(*chunk);
+            m_chunks[ci].store(chunk, std::memory_order_release);
+        }
+
+        return chunk;
+    }
+
+    void release(const Point& pt)
+    {
+        auto ci = chunkIdx(pt.x >> ChunkShift, pt.y >> ChunkShift);
+        assert(m_chunkRefs[ci] != 0);
+        if (m_chunkRefs[ci].fetch_sub(1, std::memory_order_relaxed) == 1)
+        {
+            std::lock_guard<std::mutex> lock{m_chunksMutex};
+            m_emptyChunks.push_back(ci);
+        }
     }
 
-    ObjectId makeLockId(ObjectId id) const
+    // called under m_chunksMutex
+    Chunk* allocChunk(const Chunk& tmpl)
     {
-        id.f.reserved |= CellLockFlag;
-        return id;
+        ++m_allocatedChunks;
+        if (m_spareChunks.empty())
+            return new Chunk(tmpl);
+
+        auto chunk = m_spareChunks.back().release();
+        m_spareChunks.pop_back();
+        *chunk = tmpl;
+        return chunk;
+    }
+
+    void freeChunk(Chunk* chunk)
+    {
+        --m_allocatedChunks;
+        if (m_spareChunks.size() == MaxSpareChunks)
+            delete chunk;
+        else
+            m_spareChunks.emplace_back(chunk);
+    }
+
+    unsigned templateKey(int cx, int cy) const
+    {
+        return (cx == 0 ? LeftEdge : 0u) | (cx == m_chunksX - 1 ? RightEdge : 0u)
+            | (cy == 0 ? TopEdge : 0u) | (cy == m_chunksY - 1 ? BottomEdge : 0u);
+    }
+
+    unsigned templateKey(std::size_t ci) const
+    {
+        return templateKey(static_cast<int>(ci % m_chunksX), static_cast<int>(ci / m_chunksX));
+    }
+
+    bool isTemplate(std::size_t ci, const Chunk* chunk) const
+    {
+        return chunk == m_templates[templateKey(ci)].get();
     }
 
-    bool isLocked(const Point& pt)
+    Chunk* templateFor(int cx, int cy)
     {
-        return (objectAt(pt).f.reserved & CellLockFlag) != 0;
+        auto key = templateKey(cx, cy);
+        auto&& tmpl = m_templates[key];
+        if (!tmpl)
+            tmpl = makeTemplate(key);
+        return tmpl.get();
+    }
+
+    std::unique_ptr<Chunk> makeTemplate(unsigned key) const
+    {
+        std::unique_ptr<Chunk> tmpl{new Chunk()};
+        auto lastX = (m_cx - 1) & (ChunkSize - 1);
+        auto lastY = (m_cy - 1) & (ChunkSize - 1);
+        for (auto i = 0; i != ChunkSize; ++i)
+        {
+            if (key & LeftEdge) (*tmpl)[idxInChunk(0, i)].setFlags(dirFlag(EdgeBits, Dir::Left));
+            if (key & RightEdge) (*tmpl)[idxInChunk(lastX, i)].setFlags(dirFlag(EdgeBits, Dir::Right));
+            if (key & TopEdge) (*tmpl)[idxInChunk(i, 0)].setFlags(dirFlag(EdgeBits, Dir::Up));
+            if (key & BottomEdge) (*tmpl)[idxInChunk(i, lastY)].setFlags(dirFlag(EdgeBits, Dir::Down));
+        }
+
+        return tmpl;
     }
 
     bool isValidPoint(const Point& pt) const
@@ -74,18 +464,52 @@ private:
         return pt.inside(m_cx, m_cy);
     }
 
-    void setAt(const Point& pt, ObjectId id)
+    std::size_t chunkIdx(int cx, int cy) const
+    {
+        return static_cast<std::size_t>(cy) * m_chunksX + cx;
+    }
+
+    static int lowestBit(std::uint64_t bits)
+    {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward64(&idx, bits);
+        return static_cast<int>(idx);
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+
+    static unsigned idxInChunk(int x, int y)
+    {
+        const auto TilesPerRow = ChunkSize / TileSize;
+        const auto TileMask = TilesPerRow - 1;
+        auto tile = ((y >> TileShift) & TileMask) * TilesPerRow + ((x >> TileShift) & TileMask);
+        auto inTile = ((y & (TileSize - 1)) << TileShift) + (x & (TileSize - 1));
+        return (tile << (2 * TileShift)) + inTile;
+    }
+
+    // writable only after acquire()
+    Cell& cell(const Point& pt)
     {
         assert(isValidPoint(pt));
-        m_objectTable[pt.y][pt.x] = id;
+        assert(m_chunkRefs[chunkIdx(pt.x >> ChunkShift, pt.y >> ChunkShift)] != 0);
+        return (*m_chunks[chunkIdx(pt.x >> ChunkShift, pt.y >> ChunkShift)].load(std::memory_order_acquire))[idxInChunk(pt.x, pt.y)];
     }
 
-    ObjectId getAt(const Point& pt) const
+    const Cell& cell(const Point& pt) const
     {
         assert(isValidPoint(pt));
-        return m_objectTable[pt.y][pt.x];
+        return (*m_chunks[chunkIdx(pt.x >> ChunkShift, pt.y >> ChunkShift)].load(std::memory_order_acquire))[idxInChunk(pt.x, pt.y)];
     }
 
     int m_cx, m_cy;
-    std::vector<std::vector<ObjectId>> m_objectTable;
+    int m_chunksX, m_chunksY;
+    std::vector<std::atomic<Chunk*>> m_chunks; // owned unless it is a template
+    std::vector<std::atomic<std::uint32_t>> m_chunkRefs;
+    std::array<std::unique_ptr<Chunk>, EdgeCombinations> m_templates;
+    std::vector<std::unique_ptr<Chunk>> m_spareChunks;
+    std::size_t m_allocatedChunks{0};
+    std::vector<std::size_t> m_emptyChunks; // chunks whose references dropped to zero
+    std::mutex m_chunksMutex;
 };
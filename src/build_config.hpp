@@ -3,3 +3,12 @@
 
 static const auto MaxThreads = 4;
 static const auto ThreadBlockSize = 1024;
+static const auto MinThreadBlockSize = 64;
+static const auto ObjectsChunkSize = 1024u;
+static const auto WorldChunkShift = 6; // 64x64 cells
+
+// Binary frames need websocket-cpp's Server::sendBinary; without it the
+// server refuses "proto binary" and speaks JSON only.
+#ifndef WS_BINARY_FRAMES
+#   define WS_BINARY_FRAMES 0
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "PacketBuilder.hpp"
+#include "types.hpp"
+
+// Writes a binary protocol record into a pooled buffer: a PacketType tag
+// followed by the packet's fields in a fixed order. Integers are
+// little-endian, ids are LEB128 varints, strings are a varint byte length
+// followed by UTF-8 bytes. See client/connection.js for the decoder.
+class BinaryPacketBuilder
+{
+public:
+    explicit BinaryPacketBuilder(PacketType type)
+        : m_buf(m_pooled.get())
+    {
+        u8(static_cast<std::uint8_t>(type));
+    }
+
+    BinaryPacketBuilder& u8(std::uint8_t value)
+    {
+        m_buf += static_cast<char>(value);
+        return *this;
+    }
+
+    BinaryPacketBuilder& u16(std::uint16_t value)
+    {
+        return u8(value & 0xff).u8(value >> 8);
+    }
+
+    BinaryPacketBuilder& i32(std::int32_t value)
+    {
+        auto u = static_cast<std::uint32_t>(value);
+        char bytes[] = {char(u), char(u >> 8), char(u >> 16), char(u >> 24)};
+        m_buf.append(bytes, sizeof(bytes));
+        return *this;
+    }
+
+    BinaryPacketBuilder& varint(std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            u8(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        return u8(static_cast<std::uint8_t>(value));
+    }
+
+    BinaryPacketBuilder& id(ObjectId id)
+    {
+        return varint(id.value);
+    }
+
+    BinaryPacketBuilder& str(const std::string& value)
+    {
+        varint(value.size());
+        m_buf += value;
+        return *this;
+    }
+
+    BinaryPacketBuilder& bytes(const char* data, std::size_t size)
+    {
+        m_buf.append(data, size);
+        return *this;
+    }
+
+    PacketView close()
+    {
+        return {m_buf.data(), m_buf.size()};
+    }
+
+private:
+    PooledBuffer m_pooled;
+    std::string& m_buf;
+};
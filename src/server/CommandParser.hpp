@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "math.hpp"
+#include "types.hpp"
+
+// One client command. Text arguments point into the parsed message.
+struct Command
+{
+    enum class Verb
+    {
+        Move,   // move <dir>
+        Cast,   // cast <spell> <x> <y>
+        Close,  // close
+        Proto,  // proto <json|binary>
+        Invalid,
+    };
+
+    Verb m_verb{Verb::Invalid};
+    int m_args[3];
+    const char* m_text; // the whole command, for logging
+    std::size_t m_textSize;
+    const char* m_word; // Proto argument
+    std::size_t m_wordSize;
+
+    bool wordIs(const char* str) const
+    {
+        return equals(m_word, m_wordSize, str);
+    }
+
+    static bool equals(const char* data, std::size_t size, const char* str)
+    {
+        return std::strlen(str) == size && std::memcmp(str, data, size) == 0;
+    }
+};
+
+// Splits a client message into commands without copying it. Commands are
+// separated by ';' or newlines, so a client can batch its input in one frame.
+// A direction or spell outside its enum makes the command invalid.
+class CommandParser
+{
+public:
+    CommandParser(const char* data, std::size_t size)
+        : m_pos{data}, m_end{data + size}
+    {}
+
+    // returns false when there are no more commands
+    bool next(Command& cmd)
+    {
+        while (m_pos != m_end && (isSeparator(*m_pos) || *m_pos == ' '))
+            ++m_pos;
+
+        if (m_pos == m_end)
+            return false;
+
+        m_cmdEnd = m_pos;
+        while (m_cmdEnd != m_end && !isSeparator(*m_cmdEnd))
+            ++m_cmdEnd;
+
+        cmd.m_text = m_pos;
+        cmd.m_textSize = m_cmdEnd - m_pos;
+        if (!parseCommand(cmd))
+            cmd.m_verb = Command::Verb::Invalid;
+        m_pos = m_cmdEnd;
+        return true;
+    }
+
+private:
+    static bool isSeparator(char c) { return c == ';' || c == '\n' || c == '\r'; }
+    static bool inRange(int value, int count) { return value >= 0 && value < count; }
+
+    bool parseCommand(Command& cmd)
+    {
+        const char* verb;
+        std::size_t verbSize;
+        if (!word(verb, verbSize))
+            return false;
+
+        auto is = [&](const char* str) { return Command::equals(verb, verbSize, str); };
+
+        if (is("move"))
+        {
+            cmd.m_verb = Command::Verb::Move;
+            return integer(cmd.m_args[0]) && inRange(cmd.m_args[0], DirCount) && atEnd();
+        }
+
+        if (is("cast"))
+        {
+            cmd.m_verb = Command::Verb::Cast;
+            return integer(cmd.m_args[0]) && inRange(cmd.m_args[0], SpellCount)
+                && integer(cmd.m_args[1]) && integer(cmd.m_args[2]) && atEnd();
+        }
+
+        if (is("close"))
+        {
+            cmd.m_verb = Command::Verb::Close;
+            return atEnd();
+        }
+
+        if (is("proto"))
+        {
+            cmd.m_verb = Command::Verb::Proto;
+            return word(cmd.m_word, cmd.m_wordSize) && atEnd();
+        }
+
+        return false;
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos != m_cmdEnd && *m_pos == ' ')
+            ++m_pos;
+    }
+
+    bool word(const char*& begin, std::size_t& size)
+    {
+        skipSpaces();
+        begin = m_pos;
+        while (m_pos != m_cmdEnd && *m_pos != ' ')
+            ++m_pos;
+
+        size = m_pos - begin;
+        return size != 0;
+    }
+
+    bool integer(int& value)
+    {
+        skipSpaces();
+        auto negative = m_pos != m_cmdEnd && *m_pos == '-';
+        if (negative)
+            ++m_pos;
+
+        auto digitsBegin = m_pos;
+        long long result = 0;
+        for (; m_pos != m_cmdEnd && *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+        {
+            result = result * 10 + (*m_pos - '0');
+            if (result > 0x7fffffff)
+                return false;
+        }
+
+        if (m_pos == digitsBegin || (m_pos != m_cmdEnd && *m_pos != ' '))
+            return false;
+
+        value = static_cast<int>(negative ? -result : result);
+        return true;
+    }
+
+    bool atEnd()
+    {
+        skipSpaces();
+        return m_pos == m_cmdEnd;
+    }
+
+    const char* m_pos;
+    const char* m_end;
+    const char* m_cmdEnd{nullptr};
+};
@@ -2,125 +2,252 @@
 
 #include "Game.hpp"
 
+#include <mutex>
+#include <unordered_set>
+
+#include "BinaryPacketBuilder.hpp"
+#include "MapChunks.hpp"
+#include "NetworkThread.hpp"
 #include "PacketBuilder.hpp"
-#include <websocket-cpp/Server.hpp>
+#include "PacketCache.hpp"
 
 class Connection : public EventHandler
 {
 public:
-    Connection(websocket::ConnectionId id, websocket::Server& srv)
-        : m_connId{id}, m_server{&srv}
+    // `outbox` collects the frames of all connections for the network thread
+    Connection(websocket::ConnectionId id, std::vector<OutboundFrame>& outbox, MapChunks& mapChunks, PacketCache& packetCache)
+        : m_connId{id}, m_outbox{&outbox}, m_packetCache{&packetCache}, m_mapChunks{&mapChunks}
     {}
 
     ObjectId objId() const { return m_objId; }
 
-    void sendWorldMap(int cx, const std::string& worldMap)
+    void sendWorldMap()
+    {
+        sendPacket(m_mapChunks->headerPacket(m_binary));
+    }
+
+    // Switches the protocol of the following packets; the packets already
+    // collected this tick go out first, in the old one.
+    void setBinaryProtocol(bool binary)
+    {
+        flush();
+        m_binary = binary;
+    }
+
+    // Sends the packets collected since the last flush as one frame:
+    // a JSON array, or the concatenated records of the binary protocol.
+    // Called between ticks only; a connection disconnected by the game is
+    // dropped after its last frame.
+    void flush()
     {
-        PacketBuilder p("map");
-        p.field("cx", cx);
-        p.field("cells", worldMap);
-        send(p);
+        if (!m_outFrame.empty())
+        {
+            if (!m_binary)
+                m_outFrame += ']';
+
+            auto kind = m_binary ? OutboundFrame::Kind::Binary : OutboundFrame::Kind::Text;
+            m_outbox->push_back({m_connId, kind, std::move(m_outFrame)});
+            m_outFrame.clear();
+        }
+
+        if (m_dropPending)
+        {
+            m_outbox->push_back({m_connId, OutboundFrame::Kind::Drop, {}});
+            m_dropPending = false;
+        }
     }
 
 private:
-    void send(PacketBuilder& pb)
+    // `json(PacketBuilder&)` and `binary(BinaryPacketBuilder&)` write the fields in either protocol
+    template<typename Json, typename Binary>
+    void send(PacketType type, Json&& json, Binary&& binary)
+    {
+        encode(type, json, binary, [&](PacketView packet) { sendPacket(packet); });
+    }
+
+    // for broadcast events: the fields are written once for all the observers of the event
+    template<typename Json, typename Binary>
+    void sendShared(PacketKey key, Json&& json, Binary&& binary)
+    {
+        key.m_binary = m_binary;
+        sendPacket(m_packetCache->get(key, [&](std::string& packet)
+        {
+            encode(key.m_type, json, binary, [&](PacketView view) { packet.assign(view.m_data, view.m_size); });
+        }));
+    }
+
+    template<typename Json, typename Binary, typename Sink>
+    void encode(PacketType type, Json& json, Binary& binary, Sink&& sink)
+    {
+        if (m_binary)
+        {
+            BinaryPacketBuilder p(type);
+            binary(p);
+            sink(p.close());
+        }
+        else
+        {
+            PacketBuilder p(type);
+            json(p);
+            sink(p.close());
+        }
+    }
+
+    // events of objects handled by different workers may reach one observer at once
+    void sendPacket(PacketView packet)
+    {
+        std::lock_guard<std::mutex> lock{m_frameMutex};
+        if (!m_binary)
+            m_outFrame += m_outFrame.empty() ? '[' : ',';
+        m_outFrame.append(packet.m_data, packet.m_size);
+    }
+
+    // sends the map chunks around the player that the client doesn't have yet
+    void streamMap()
     {
-        m_server->sendText(m_connId, pb.close());
+        m_mapChunks->forChunksAround(m_pos, [&](unsigned chunkIdx)
+        {
+            if (m_sentChunks.insert(chunkIdx).second)
+                sendPacket(m_mapChunks->packet(chunkIdx, m_binary));
+        });
     }
 
     virtual void init(const InitInfo& info) override
     {
         m_objId = info.m_id;
-
-        PacketBuilder p("init");
-        p.field("id", info.m_id);
-        p.field("x", info.m_pos.x);
-        p.field("y", info.m_pos.y);
-        p.field("hp", info.m_health);
-        p.field("name", info.m_name);
-        send(p);
+        m_pos = info.m_pos;
+        streamMap();
+
+        send(PacketType::Init, [&](PacketBuilder& p)
+        {
+            p.field("id", info.m_id);
+            p.field("x", info.m_pos.x);
+            p.field("y", info.m_pos.y);
+            p.field("hp", info.m_health);
+            p.field("name", info.m_name);
+        },
+        [&](BinaryPacketBuilder& p)
+        {
+            p.id(info.m_id).i32(info.m_pos.x).i32(info.m_pos.y).i32(info.m_health).str(info.m_name);
+        });
     }
 
     virtual void seePlayer(const FullPlayerInfo& info) override
     {
-        PacketBuilder p("see_player");
-        p.field("id", info.m_id);
-        p.field("dir", static_cast<int>(info.m_moveDir));
-        p.field("state", static_cast<int>(info.m_state));
-        p.field("x", info.m_pos.x);
-        p.field("y", info.m_pos.y);
-        p.field("name", info.m_name);
-        send(p);
+        // the name is fixed for an id, so it isn't part of the key
+        auto state = static_cast<int>(info.m_state) << 8 | static_cast<int>(info.m_moveDir);
+        sendShared({PacketType::SeePlayer, info.m_id, info.m_pos.x, info.m_pos.y, state}, [&](PacketBuilder& p)
+        {
+            p.field("id", info.m_id);
+            p.field("dir", static_cast<int>(info.m_moveDir));
+            p.field("state", static_cast<int>(info.m_state));
+            p.field("x", info.m_pos.x);
+            p.field("y", info.m_pos.y);
+            p.field("name", info.m_name);
+        },
+        [&](BinaryPacketBuilder& p)
+        {
+            p.id(info.m_id).u8(static_cast<std::uint8_t>(info.m_moveDir)).u8(static_cast<std::uint8_t>(info.m_state));
+            p.i32(info.m_pos.x).i32(info.m_pos.y).str(info.m_name);
+        });
     }
 
+    // runs on a tick worker, so the Drop frame is left to flush()
     virtual void disconnect() override
     {
-        PacketBuilder p("disconnect");
-        send(p);
-        m_server->drop(m_connId);
+        send(PacketType::Disconnect, [](PacketBuilder&) {}, [](BinaryPacketBuilder&) {});
+        m_dropPending = true;
+    }
+
+    // packets that carry only the object id
+    void sendIdEvent(PacketType type, ObjectId id)
+    {
+        sendShared({type, id, 0, 0, 0},
+            [&](PacketBuilder& p) { p.field("id", id); },
+            [&](BinaryPacketBuilder& p) { p.id(id); });
     }
 
     virtual void seeDisappear(ObjectId id) override
     {
-        PacketBuilder p("see_disappear");
-        p.field("id", id);
-        send(p);
+        sendIdEvent(PacketType::SeeDisappear, id);
     }
 
     virtual void seeBeginMove(const MoveInfo& info) override
     {
-        PacketBuilder p("see_begin_move");
-        p.field("id", info.id);
-        p.field("dir", static_cast<int>(info.moveDir));
-        send(p);
+        if (info.id == m_objId)
+            m_moveDir = info.moveDir;
+
+        auto dir = static_cast<int>(info.moveDir);
+        sendShared({PacketType::SeeBeginMove, info.id, dir, 0, 0},
+            [&](PacketBuilder& p) { p.field("id", info.id).field("dir", dir); },
+            [&](BinaryPacketBuilder& p) { p.id(info.id).u8(static_cast<std::uint8_t>(dir)); });
     }
 
     virtual void seeCrossCellBorder(ObjectId id) override
     {
-        PacketBuilder p("see_cross_cell");
-        p.field("id", id);
-        send(p);
+        if (id == m_objId)
+        {
+            auto oldChunk = MapChunks::chunkOf(m_pos);
+            m_pos = moveRel(m_pos, m_moveDir);
+            if (MapChunks::chunkOf(m_pos) != oldChunk)
+                streamMap();
+        }
+
+        sendIdEvent(PacketType::SeeCrossCell, id);
     }
 
     virtual void seeStop(ObjectId id) override
     {
-        PacketBuilder p("see_stop");
-        p.field("id", id);
-        send(p);
+        sendIdEvent(PacketType::SeeStop, id);
     }
 
     virtual void seeBeginCast(const CastInfo& info) override
     {
-        PacketBuilder p("see_cast");
-        p.field("id", info.m_id);
-        p.field("spell", static_cast<int>(info.m_spell));
-        send(p);
+        auto spell = static_cast<int>(info.m_spell);
+        sendShared({PacketType::SeeCast, info.m_id, spell, 0, 0},
+            [&](PacketBuilder& p) { p.field("id", info.m_id).field("spell", spell); },
+            [&](BinaryPacketBuilder& p) { p.id(info.m_id).u8(static_cast<std::uint8_t>(spell)); });
     }
 
     virtual void seeEndCast(ObjectId id) override
     {
-        PacketBuilder p("see_end_cast");
-        p.field("id", id);
-        send(p);
+        sendIdEvent(PacketType::SeeEndCast, id);
     }
 
     virtual void seeEffect(const SpellEffect& effect) override
     {
-        PacketBuilder p("see_effect");
-        p.field("x", effect.m_pos.x);
-        p.field("y", effect.m_pos.y);
-        p.field("effect", static_cast<int>(effect.m_effect));
-        send(p);
+        auto effectId = static_cast<int>(effect.m_effect);
+        sendShared({PacketType::SeeEffect, ObjectId{}, effect.m_pos.x, effect.m_pos.y, effectId}, [&](PacketBuilder& p)
+        {
+            p.field("x", effect.m_pos.x);
+            p.field("y", effect.m_pos.y);
+            p.field("effect", effectId);
+        },
+        [&](BinaryPacketBuilder& p)
+        {
+            p.i32(effect.m_pos.x).i32(effect.m_pos.y).u8(static_cast<std::uint8_t>(effectId));
+        });
     }
 
     virtual void healthChange(int newHP) override
     {
-        PacketBuilder p("hp_change");
-        p.field("hp", newHP);
-        send(p);
+        send(PacketType::HpChange,
+            [&](PacketBuilder& p) { p.field("hp", newHP); },
+            [&](BinaryPacketBuilder& p) { p.i32(newHP); });
     }
 
     websocket::ConnectionId m_connId;
-    websocket::Server* m_server;
+    std::vector<OutboundFrame>* m_outbox;
     ObjectId m_objId{0};
+    bool m_binary{false};
+    std::string m_outFrame;
+    std::mutex m_frameMutex;
+    bool m_dropPending{false};
+    PacketCache* m_packetCache;
+
+    // own position, followed through the player's own move events
+    MapChunks* m_mapChunks;
+    Point m_pos;
+    Dir m_moveDir;
+    std::unordered_set<unsigned> m_sentChunks;
 };
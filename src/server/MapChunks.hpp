@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MapFile.hpp"
+#include "BinaryPacketBuilder.hpp"
+#include "PacketBuilder.hpp"
+
+// The map is streamed to clients in square chunks around their position.
+// A chunk packet is encoded on first request and shared by all connections
+// using the same protocol.
+class MapChunks
+{
+public:
+    static const auto ChunkSize = 16;
+
+    explicit MapChunks(const MapFile& map)
+        : m_map{&map}
+        , m_chunksX{(map.cx() + ChunkSize - 1) / ChunkSize}
+        , m_chunksY{(map.cy() + ChunkSize - 1) / ChunkSize}
+        , m_packets(static_cast<std::size_t>(m_chunksX) * m_chunksY)
+    {}
+
+    // map dimensions, sent once before any chunk
+    std::string headerPacket(bool binary) const
+    {
+        if (binary)
+        {
+            BinaryPacketBuilder p(PacketType::Map);
+            p.i32(m_map->cx()).i32(m_map->cy());
+            return p.close().str();
+        }
+
+        PacketBuilder p(PacketType::Map);
+        p.field("cx", m_map->cx());
+        p.field("cy", m_map->cy());
+        return p.close().str();
+    }
+
+    static Point chunkOf(const Point& pt)
+    {
+        return {pt.x / ChunkSize, pt.y / ChunkSize};
+    }
+
+    // calls `f(chunkIdx)` for the chunk of `pt` and the ones next to it
+    template<typename F>
+    void forChunksAround(const Point& pt, F&& f) const
+    {
+        auto center = chunkOf(pt);
+        for (auto y = std::max(center.y - 1, 0); y <= std::min(center.y + 1, m_chunksY - 1); ++y)
+            for (auto x = std::max(center.x - 1, 0); x <= std::min(center.x + 1, m_chunksX - 1); ++x)
+                f(static_cast<unsigned>(y * m_chunksX + x));
+    }
+
+    // may be called from the tick threads
+    const std::string& packet(unsigned chunkIdx, bool binary)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        auto&& packet = m_packets[chunkIdx][binary];
+        if (packet.empty())
+            packet = binary ? encodeBinary(chunkIdx) : encode(chunkIdx);
+        return packet;
+    }
+
+private:
+    std::string encode(unsigned chunkIdx) const
+    {
+        auto x0 = static_cast<int>(chunkIdx % m_chunksX) * ChunkSize;
+        auto y0 = static_cast<int>(chunkIdx / m_chunksX) * ChunkSize;
+        auto cx = std::min(int{ChunkSize}, m_map->cx() - x0);
+        auto cy = std::min(int{ChunkSize}, m_map->cy() - y0);
+
+        std::string cells;
+        cells.reserve(cx * cy);
+        for (auto y = y0; y != y0 + cy; ++y)
+        {
+            auto walls = m_map->wallBits(x0, y);
+            for (auto x = 0; x != cx; ++x)
+                cells += (walls >> x) & 1 ? 'W' : '.';
+        }
+
+        PacketBuilder p(PacketType::MapChunk);
+        p.field("x", x0);
+        p.field("y", y0);
+        p.field("cx", cx);
+        p.field("cells", cells);
+        return p.close().str();
+    }
+
+    // walls as a row-major bitfield, LSB first
+    std::string encodeBinary(unsigned chunkIdx) const
+    {
+        auto x0 = static_cast<int>(chunkIdx % m_chunksX) * ChunkSize;
+        auto y0 = static_cast<int>(chunkIdx / m_chunksX) * ChunkSize;
+        auto cx = std::min(int{ChunkSize}, m_map->cx() - x0);
+        auto cy = std::min(int{ChunkSize}, m_map->cy() - y0);
+
+        std::string bits((cx * cy + 7) / 8, '\0');
+        auto bit = 0;
+        for (auto y = y0; y != y0 + cy; ++y)
+        {
+            auto walls = m_map->wallBits(x0, y);
+            for (auto x = 0; x != cx; ++x, ++bit)
+                if ((walls >> x) & 1)
+                    bits[bit >> 3] |= static_cast<char>(1 << (bit & 7));
+        }
+
+        BinaryPacketBuilder p(PacketType::MapChunk);
+        p.i32(x0).i32(y0).u16(static_cast<std::uint16_t>(cx)).u16(static_cast<std::uint16_t>(cy));
+        p.bytes(bits.data(), bits.size());
+        return p.close().str();
+    }
+
+    const MapFile* m_map;
+    int m_chunksX, m_chunksY;
+
+    std::mutex m_mutex;
+    std::vector<std::array<std::string, 2>> m_packets; // [chunkIdx][binary]
+};
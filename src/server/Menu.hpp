@@ -29,6 +29,9 @@ public:
 
     bool quitRequested() const { return m_quitRequested; }
 
+    // true for the tick in which the key was pressed
+    bool profileRequested() const { return m_lastInput == 'p'; }
+
 private:
     void pollInput()
     {
@@ -39,6 +42,7 @@ private:
     {
         std::cout << R"(
 q - quit
+p - print tick phase latencies
 h or ? - this message
 )";
     }
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "build_config.hpp"
+#include "Object.hpp"
+#include "SpscRing.hpp"
+
+#include "CommandParser.hpp"
+#include <websocket-cpp/Server.hpp>
+
+// what the network thread hands to the game thread
+struct InboundEvent
+{
+    enum class Kind : std::uint8_t { NewConnection, Action, Protocol, Disconnect };
+
+    Kind m_kind;
+    websocket::ConnectionId m_connId;
+    ActionData m_action; // Action
+    bool m_binary;       // Protocol
+};
+
+// what the game thread hands to the network thread
+struct OutboundFrame
+{
+    enum class Kind : std::uint8_t { Text, Binary, Drop };
+
+    websocket::ConnectionId m_connId;
+    Kind m_kind;
+    std::string m_data;
+};
+
+struct InboundStats
+{
+    std::uint64_t m_messages;
+    std::uint64_t m_commands;
+    std::uint64_t m_invalid;
+    std::uint64_t m_dropped; // beyond MaxCommandsPerMessage
+    std::uint64_t m_parseNs;
+
+    void print(std::ostream& os) const
+    {
+        os << "inbound: " << m_messages << " messages, " << m_commands << " commands, "
+            << m_invalid << " invalid, " << m_dropped << " dropped, "
+            << (m_messages ? m_parseNs / m_messages : 0) << " ns parse per message\n";
+    }
+};
+
+// Owns all websocket::Server calls after start(): polls and parses inbound
+// messages and writes outbound frames on its own thread, so socket activity
+// doesn't delay the tick. Talks to the game thread through SPSC rings only.
+class NetworkThread
+{
+public:
+    explicit NetworkThread(websocket::Server& wsServer) : m_wsServer{&wsServer} {}
+
+    NetworkThread(const NetworkThread&) = delete;
+    void operator=(const NetworkThread&) = delete;
+
+    ~NetworkThread() { stop(); }
+
+    void start()
+    {
+        assert(!m_thread.joinable());
+        m_stopRequested = false;
+        m_thread = std::thread{[this] { threadMain(); }};
+    }
+
+    // sends the frames queued so far, then stops
+    void stop()
+    {
+        if (!m_thread.joinable())
+            return;
+
+        m_stopRequested = true;
+        m_thread.join();
+    }
+
+    // game thread
+    bool receive(InboundEvent& event)
+    {
+        return m_inbound.pop(event);
+    }
+
+    // game thread: queues as many frames as fit and removes them from `frames`
+    void send(std::vector<OutboundFrame>& frames)
+    {
+        auto sent = 0u;
+        while (sent != frames.size() && m_outbound.push(std::move(frames[sent])))
+            ++sent;
+
+        frames.erase(frames.begin(), frames.begin() + sent);
+    }
+
+    InboundStats inboundStats() const
+    {
+        return {m_messages.load(std::memory_order_relaxed), m_commands.load(std::memory_order_relaxed),
+            m_invalid.load(std::memory_order_relaxed), m_dropped.load(std::memory_order_relaxed),
+            m_parseNs.load(std::memory_order_relaxed)};
+    }
+
+private:
+    static const auto MaxCommandsPerMessage = 16u;
+    static const std::size_t RingSize = 4096;
+
+    void threadMain()
+    {
+        for (;;)
+        {
+            auto stopping = m_stopRequested.load();
+            auto busy = writeFrames();
+            if (stopping)
+                break;
+
+            busy |= pollConnections();
+            if (!busy)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool writeFrames()
+    {
+        auto busy = false;
+        OutboundFrame frame;
+        while (m_outbound.pop(frame))
+        {
+            busy = true;
+            switch (frame.m_kind)
+            {
+            case OutboundFrame::Kind::Text: m_wsServer->sendText(frame.m_connId, frame.m_data); break;
+#if WS_BINARY_FRAMES
+            case OutboundFrame::Kind::Binary: m_wsServer->sendBinary(frame.m_connId, frame.m_data); break;
+#else
+            case OutboundFrame::Kind::Binary: assert(!"binary protocol is not built in"); break;
+#endif
+            case OutboundFrame::Kind::Drop: m_wsServer->drop(frame.m_connId); break;
+            }
+        }
+
+        return busy;
+    }
+
+    // stops reading while the game thread is behind, so the inbound ring never overflows
+    bool pollConnections()
+    {
+        auto busy = false;
+        websocket::Event event;
+        websocket::ConnectionId id;
+
+        while (hasRoomForMessage() && m_wsServer->poll(event, id, m_msg))
+        {
+            busy = true;
+            switch (event)
+            {
+            case websocket::Event::NewConnection:
+                push({InboundEvent::Kind::NewConnection, id, {}, false});
+                break;
+
+            case websocket::Event::Message:
+                onMessage(id);
+                break;
+
+            case websocket::Event::Disconnect:
+                push({InboundEvent::Kind::Disconnect, id, {}, false});
+                break;
+            }
+        }
+
+        return busy;
+    }
+
+    bool hasRoomForMessage() const
+    {
+        return m_inbound.freeSpace() >= MaxCommandsPerMessage;
+    }
+
+    void push(InboundEvent&& event)
+    {
+        auto pushed = m_inbound.push(std::move(event));
+        assert(pushed && "hasRoomForMessage() keeps a message worth of space");
+        (void)pushed;
+    }
+
+    void onMessage(websocket::ConnectionId connId)
+    {
+        auto parseStart = std::chrono::steady_clock::now();
+        CommandParser parser{m_msg.data(), m_msg.size()};
+        std::array<Command, MaxCommandsPerMessage> commands;
+        auto commandsCount = 0u;
+        Command extra;
+        while (commandsCount != commands.size() && parser.next(commands[commandsCount]))
+            ++commandsCount;
+        auto dropped = 0u;
+        while (parser.next(extra))
+            ++dropped;
+
+        m_messages.fetch_add(1, std::memory_order_relaxed);
+        m_commands.fetch_add(commandsCount, std::memory_order_relaxed);
+        m_dropped.fetch_add(dropped, std::memory_order_relaxed);
+        m_parseNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - parseStart).count(), std::memory_order_relaxed);
+
+        for (auto i = 0u; i != commandsCount; ++i)
+        {
+            auto&& cmd = commands[i];
+            InboundEvent event{InboundEvent::Kind::Action, connId, {}, false};
+
+            switch (cmd.m_verb)
+            {
+            case Command::Verb::Move:
+                event.m_action.m_action = Action::Move;
+                event.m_action.m_moveDir = static_cast<Dir>(cmd.m_args[0]);
+                break;
+
+            case Command::Verb::Cast:
+                event.m_action.m_action = Action::Cast;
+                event.m_action.m_spell = static_cast<Spell>(cmd.m_args[0]);
+                event.m_action.m_castDest = {cmd.m_args[1], cmd.m_args[2]};
+                break;
+
+            case Command::Verb::Close:
+                event.m_action.m_action = Action::Disconnect;
+                break;
+
+            case Command::Verb::Proto:
+#if !WS_BINARY_FRAMES
+                if (cmd.wordIs("binary"))
+                {
+                    std::cout << "binary protocol is not built in, staying with JSON\n";
+                    continue;
+                }
+#endif
+                event.m_kind = InboundEvent::Kind::Protocol;
+                event.m_binary = cmd.wordIs("binary");
+                break;
+
+            case Command::Verb::Invalid:
+                m_invalid.fetch_add(1, std::memory_order_relaxed);
+                std::cout << "unknown packet: ";
+                std::cout.write(cmd.m_text, cmd.m_textSize) << '\n';
+                continue;
+            }
+
+            push(std::move(event));
+        }
+    }
+
+    websocket::Server* m_wsServer;
+    std::thread m_thread;
+    std::atomic<bool> m_stopRequested{false};
+
+    SpscRing<InboundEvent, RingSize> m_inbound;
+    SpscRing<OutboundFrame, RingSize> m_outbound;
+    std::string m_msg;
+
+    std::atomic<std::uint64_t> m_messages{0};
+    std::atomic<std::uint64_t> m_commands{0};
+    std::atomic<std::uint64_t> m_invalid{0};
+    std::atomic<std::uint64_t> m_dropped{0};
+    std::atomic<std::uint64_t> m_parseNs{0};
+};
@@ -2,20 +2,97 @@
 
 #include <cassert>
 #include <cstdint>
-#include <sstream>
+#include <string>
+#include <deque>
 #include "types.hpp"
 
+// Non-owning view of an encoded packet, valid while its PacketBuilder lives.
+struct PacketView
+{
+    PacketView(const char* data, std::size_t size) : m_data{data}, m_size{size} {}
+    PacketView(const std::string& str) : m_data{str.data()}, m_size{str.size()} {}
+
+    std::string str() const { return {m_data, m_size}; }
+
+    const char* m_data;
+    std::size_t m_size;
+};
+
+// Server-to-client packet types. The numeric values are the record tags of
+// the binary protocol, the names are the "type" of the JSON packets.
+enum class PacketType : std::uint8_t
+{
+    Map = 1, MapChunk, Init, SeePlayer, Disconnect, SeeDisappear, SeeBeginMove,
+    SeeCrossCell, SeeStop, SeeCast, SeeEndCast, SeeEffect, HpChange,
+};
+
+inline const char* packetName(PacketType type)
+{
+    static const char* names[] = {
+        "", "map", "map_chunk", "init", "see_player", "disconnect", "see_disappear", "see_begin_move",
+        "see_cross_cell", "see_stop", "see_cast", "see_end_cast", "see_effect", "hp_change",
+    };
+    return names[static_cast<int>(type)];
+}
+
+// A per-thread pooled std::string, so building a packet doesn't allocate
+// once the buffers have grown. Builders may nest, so each live one on a
+// thread owns a separate buffer.
+class PooledBuffer
+{
+public:
+    PooledBuffer() : m_buf{acquire()} { m_buf.clear(); }
+    ~PooledBuffer() { --pool().m_inUse; }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    void operator=(const PooledBuffer&) = delete;
+
+    std::string& get() { return m_buf; }
+
+private:
+    struct Pool
+    {
+        std::deque<std::string> m_buffers; // grows without moving the buffers in use
+        unsigned m_inUse{0};
+    };
+
+    static Pool& pool()
+    {
+        static thread_local Pool threadPool;
+        return threadPool;
+    }
+
+    static std::string& acquire()
+    {
+        auto&& p = pool();
+        if (p.m_inUse == p.m_buffers.size())
+            p.m_buffers.emplace_back();
+        return p.m_buffers[p.m_inUse++];
+    }
+
+    std::string& m_buf;
+};
+
+// Writes a JSON packet into a pooled buffer.
 class PacketBuilder
 {
 public:
     explicit PacketBuilder(const char* type)
+        : m_buf(m_pooled.get())
     {
-        ss << "{\"type\":\"" << type << '"';
+        m_buf += "{\"type\":\"";
+        m_buf += type;
+        m_buf += '"';
     }
 
+    explicit PacketBuilder(PacketType type)
+        : PacketBuilder{packetName(type)}
+    {}
+
     PacketBuilder& field(const char* name, int value)
     {
-        ss << ",\"" << name << "\":" << value;
+        key(name);
+        writeInt(value);
         return *this;
     }
 
@@ -27,23 +104,94 @@ public:
     PacketBuilder& field(const char* name, std::uint64_t value)
     {
         assert(double(value) == value && "value won't fit in JS Number");
-        ss << ",\"" << name << "\":" << value;
+        key(name);
+        writeUInt(value);
         return *this;
     }
 
     PacketBuilder& field(const char* name, const std::string& value)
     {
-        ss << ",\"" << name << "\":\"" << value << '"';
+        key(name);
+        m_buf += '"';
+        writeEscaped(value);
+        m_buf += '"';
         return *this;
     }
 
-    std::string close()
+    PacketView close()
     {
-        ss << '}';
-        return ss.str();
+        m_buf += '}';
+        return {m_buf.data(), m_buf.size()};
     }
 
 private:
-    std::stringstream ss;
-};
+    void key(const char* name)
+    {
+        m_buf += ",\"";
+        m_buf += name;
+        m_buf += "\":";
+    }
+
+    void writeInt(int value)
+    {
+        auto magnitude = static_cast<unsigned>(value);
+        if (value < 0)
+        {
+            m_buf += '-';
+            magnitude = 0u - magnitude;
+        }
 
+        writeUInt(magnitude);
+    }
+
+    void writeUInt(std::uint64_t value)
+    {
+        char digits[20];
+        auto end = digits + sizeof(digits);
+        auto p = end;
+        do
+        {
+            *--p = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        m_buf.append(p, end);
+    }
+
+    void writeEscaped(const std::string& value)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        auto begin = value.data();
+        auto end = begin + value.size();
+        auto run = begin;
+        for (auto p = begin; p != end; ++p)
+        {
+            auto c = static_cast<unsigned char>(*p);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            m_buf.append(run, p);
+            run = p + 1;
+
+            m_buf += '\\';
+            switch (c)
+            {
+            case '"': m_buf += '"'; break;
+            case '\\': m_buf += '\\'; break;
+            case '\n': m_buf += 'n'; break;
+            case '\r': m_buf += 'r'; break;
+            case '\t': m_buf += 't'; break;
+            default:
+                m_buf += "u00";
+                m_buf += hex[c >> 4];
+                m_buf += hex[c & 15];
+            }
+        }
+
+        m_buf.append(run, end);
+    }
+
+    PooledBuffer m_pooled;
+    std::string& m_buf;
+};
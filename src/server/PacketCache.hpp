@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "types.hpp"
+#include "PacketBuilder.hpp"
+
+// Identifies a broadcast packet by its content, so every observer of an
+// event gets the same encoded bytes.
+struct PacketKey
+{
+    PacketType m_type;
+    ObjectId m_id;
+    int m_a, m_b, m_c;
+    bool m_binary{false}; // the same event is cached once per protocol
+};
+
+inline bool operator==(const PacketKey& lhs, const PacketKey& rhs)
+{
+    return lhs.m_type == rhs.m_type && lhs.m_id == rhs.m_id && lhs.m_binary == rhs.m_binary
+        && lhs.m_a == rhs.m_a && lhs.m_b == rhs.m_b && lhs.m_c == rhs.m_c;
+}
+
+// Encodes each broadcast event once for all of its observers. Game notifies
+// the observers of an event one after another on the worker that produced it,
+// so every thread keeps only the packet it encoded last; there is no shared
+// table to lock. Observers still copy the bytes, since each connection sends
+// its packets batched into one frame per tick.
+class PacketCache
+{
+public:
+    // May be called from the tick threads. `encode(std::string&)` writes the
+    // packet; the result is valid until the next get() on the same thread.
+    template<typename Encode>
+    const std::string& get(const PacketKey& key, Encode&& encode)
+    {
+        // one slot per protocol, so mixed JSON and binary observers don't evict each other
+        auto&& last = lastPackets()[key.m_binary];
+        if (last.m_generation != m_generation || !(last.m_key == key))
+        {
+            last.m_generation = m_generation;
+            last.m_key = key;
+            last.m_packet.clear();
+            encode(last.m_packet);
+        }
+
+        return last.m_packet;
+    }
+
+    // forgets the packets of the tick; called between ticks
+    void clear()
+    {
+        m_generation = nextGeneration();
+    }
+
+private:
+    struct LastPacket
+    {
+        std::uint64_t m_generation{0};
+        PacketKey m_key{};
+        std::string m_packet;
+    };
+
+    static LastPacket* lastPackets()
+    {
+        static thread_local LastPacket last[2];
+        return last;
+    }
+
+    // unique across all caches, so a thread's packet never matches another cache
+    static std::uint64_t nextGeneration()
+    {
+        static std::atomic<std::uint64_t> generation{0};
+        return ++generation;
+    }
+
+    std::uint64_t m_generation{nextGeneration()};
+};
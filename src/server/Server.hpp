@@ -5,59 +5,121 @@
 #include <unordered_map>
 
 #include "Game.hpp"
+#include "MapFile.hpp"
 
 #include "Connection.hpp"
+#include "MapChunks.hpp"
+#include "NetworkThread.hpp"
 #include "PacketBuilder.hpp"
+#include "PacketCache.hpp"
 #include <websocket-cpp/Server.hpp>
 #include <websocket-cpp/server_src.hpp>
 
 class Server
 {
 public:
-    Server(const GameCfg& cfg, const std::string& worldMap)
+    // `map` is used in place and must outlive the server; see loadMap()
+    Server(const GameCfg& cfg, const MapFile& map)
         : m_gameCfg{cfg}
-        , m_worldMap{worldMap}
+        , m_map(map)
+        , m_mapChunks{map}
+    {}
+
+    // loads the walls and spawn points into the game, before start();
+    // false if the map size differs from GameCfg
+    bool loadMap()
     {
-        parseMap();
+        if (m_map.cx() != m_gameCfg.worldCX || m_map.cy() != m_gameCfg.worldCY)
+            return false;
+
+        m_game.m_geodata.loadWalls(m_map);
+        m_spawns = m_map.spawns();
+        return true;
     }
 
     void start(const std::string& ip, unsigned short port, std::ostream& log)
     {
         m_wsServer.start(ip, port, log);
+        m_network.start();
     }
 
     void tick()
     {
+        auto& profiler = m_game.profiler();
+        TickProfiler::Scope tickScope{profiler, TickPhase::Tick};
+
         m_game.tick();
-        pollConnections();
+
+        {
+            TickProfiler::Scope scope{profiler, TickPhase::PollConnections};
+            pollConnections();
+        }
+
+        TickProfiler::Scope scope{profiler, TickPhase::Flush};
+        for (auto&& conn : m_conn)
+            conn.second->flush();
+
+        m_packetCache.clear();
+
+        // frames that don't fit into the ring wait for the next tick
+        m_network.send(m_outbox);
     }
 
     void stop()
     {
+        m_network.send(m_outbox);
+        m_network.stop();
         m_wsServer.stop();
+
+        m_game.setJournal(nullptr);
+        m_journal.close();
+    }
+
+    // records all player input from now on, see tools/replay
+    bool startJournal(const std::string& path)
+    {
+        if (!m_journal.open(path, m_gameCfg, &m_map))
+            return false;
+
+        m_game.setJournal(&m_journal);
+        return true;
+    }
+
+    InboundStats inboundStats() const { return m_network.inboundStats(); }
+
+    TickProfiler& profiler() { return m_game.profiler(); }
+
+    // the tick phase table and the network thread's inbound counters
+    void printProfile(std::ostream& os)
+    {
+        m_game.profiler().print(os);
+        inboundStats().print(os);
     }
 
 private:
+    // handles what the network thread has received since the last tick
     void pollConnections()
     {
-        websocket::Event event;
-        websocket::ConnectionId id;
-        std::string msg;
-
-        while (m_wsServer.poll(event, id, msg))
+        InboundEvent event;
+        while (m_network.receive(event))
         {
-            switch (event)
+            switch (event.m_kind)
             {
-            case websocket::Event::NewConnection:
-                onNewConnection(id);
+            case InboundEvent::Kind::NewConnection:
+                onNewConnection(event.m_connId);
+                break;
+
+            case InboundEvent::Kind::Action:
+                // one action per tick: a later command replaces an earlier one
+                m_game.enqueueAction(m_conn[event.m_connId]->objId(), event.m_action);
                 break;
 
-            case websocket::Event::Message:
-                onMessage(id, msg);
+            case InboundEvent::Kind::Protocol:
+                m_conn[event.m_connId]->setBinaryProtocol(event.m_binary);
                 break;
 
-            case websocket::Event::Disconnect:
-                onDisconnect(id);
+            case InboundEvent::Kind::Disconnect:
+                onDisconnect(event.m_connId);
                 break;
             }
         }
@@ -66,53 +128,14 @@ private:
     void onNewConnection(websocket::ConnectionId connId)
     {
         assert(m_conn.count(connId) == 0);
-        m_conn[connId] = std::make_unique<Connection>(connId, m_wsServer);
+        m_conn[connId] = std::make_unique<Connection>(connId, m_outbox, m_mapChunks, m_packetCache);
 
-        m_conn[connId]->sendWorldMap(m_gameCfg.worldCX, m_worldMap);
+        m_conn[connId]->sendWorldMap();
 
         Point pos{(int)connId % m_game.m_cfg.worldCX, (int)connId % m_game.m_cfg.worldCY};
         m_game.newPlayer(*m_conn[connId], pos, std::to_string(connId));
     }
 
-    void onMessage(websocket::ConnectionId connId, const std::string& msg)
-    {
-        auto objId = m_conn[connId]->objId();
-        assert(objId);
-
-        ActionData actionData;
-
-        std::stringstream msgStream(msg);
-        std::string verb; msgStream >> verb;
-        if (verb == "move")
-        {
-            int dir;
-            msgStream >> dir;
-
-            actionData.m_action = Action::Move;
-            actionData.m_moveDir = static_cast<Dir>(dir);
-        }
-        else if (verb == "cast")
-        {
-            int spell, x, y;
-            msgStream >> spell >> x >> y;
-
-            actionData.m_action = Action::Cast;
-            actionData.m_spell = static_cast<Spell>(spell);
-            actionData.m_castDest = {x, y};
-        }
-        else if (verb == "close")
-        {
-            actionData.m_action = Action::Disconnect;
-        }
-        else
-        {
-            std::cout << "unknown packet: " << msg << '\n';
-        }
-
-        if (!actionData.empty())
-            m_game.enqueueAction(objId, actionData);
-    }
-
     void onDisconnect(websocket::ConnectionId connId)
     {
         if (auto objId = m_conn[connId]->objId())
@@ -126,42 +149,18 @@ private:
         m_conn.erase(connId);
     }
 
-    void parseMap()
-    {
-        assert((int)m_worldMap.size() == m_gameCfg.worldCX * m_gameCfg.worldCY);
-        auto cellIdx = 0;         
-        for (auto y = 0; y != m_gameCfg.worldCY; ++y)
-        {
-            for (auto x = 0; x != m_gameCfg.worldCX; ++x, ++cellIdx)
-            {
-                Point pt{x, y};
-
-                switch (m_worldMap[cellIdx])
-                {
-                case '.': break; // empty cell
-
-                case 'W':
-                    m_game.m_geodata.addWall(pt);
-                    break;
-
-                case '?':
-                    m_spawns.push_back(pt);
-                    break;
-
-                default:
-                    assert(!"unknown cell type");
-                }
-            }
-        }
-    }
-
     websocket::Server m_wsServer;
+    NetworkThread m_network{m_wsServer};
+    std::vector<OutboundFrame> m_outbox;
 
     const GameCfg& m_gameCfg;
+    const MapFile& m_map;
     Game m_game{m_gameCfg};
+    JournalWriter m_journal;
 
     std::unordered_map<websocket::ConnectionId, std::unique_ptr<Connection>> m_conn;
 
-    std::string m_worldMap;
+    MapChunks m_mapChunks;
+    PacketCache m_packetCache;
     std::vector<Point> m_spawns;
 };
\ No newline at end of file
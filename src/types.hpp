@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <type_traits>
 
 struct ObjectId
@@ -68,6 +69,8 @@ enum class Spell
     Lightning, SelfHeal,
 };
 
+const auto SpellCount = 2;
+
 enum class Effect
 {
     None, Lightning,
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.hpp"
+#include "events.hpp"
+#include "Game.hpp"
+
+// minimal EventHandler that only counts events
+struct BenchClient : EventHandler
+{
+    Game* m_game;
+    ObjectId m_id;
+    unsigned long long m_eventsCount{0};
+
+    BenchClient(Game& game, std::string name, Point pos) : m_game{&game}
+    {
+        game.newPlayer(*this, pos, std::move(name));
+    }
+
+    void requestMove(Dir direction)
+    {
+        ActionData ad;
+        ad.m_action = Action::Move;
+        ad.m_moveDir = direction;
+        m_game->enqueueAction(m_id, ad);
+    }
+
+    void requestCast(Spell spell, Point dest)
+    {
+        ActionData ad;
+        ad.m_action = Action::Cast;
+        ad.m_spell = spell;
+        ad.m_castDest = dest;
+        m_game->enqueueAction(m_id, ad);
+    }
+
+private:
+    virtual void init(const InitInfo& info) override { m_id = info.m_id; ++m_eventsCount; }
+    virtual void seePlayer(const FullPlayerInfo&) override { ++m_eventsCount; }
+    virtual void disconnect() override { ++m_eventsCount; }
+    virtual void seeDisappear(ObjectId) override { ++m_eventsCount; }
+    virtual void seeBeginMove(const MoveInfo&) override { ++m_eventsCount; }
+    virtual void seeCrossCellBorder(ObjectId) override { ++m_eventsCount; }
+    virtual void seeStop(ObjectId) override { ++m_eventsCount; }
+    virtual void seeBeginCast(const CastInfo&) override { ++m_eventsCount; }
+    virtual void seeEndCast(ObjectId) override { ++m_eventsCount; }
+    virtual void seeEffect(const SpellEffect&) override { ++m_eventsCount; }
+    virtual void healthChange(int) override { ++m_eventsCount; }
+};
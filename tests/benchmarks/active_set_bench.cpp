@@ -0,0 +1,43 @@
+#include "Game.hpp"
+
+#include "catch.hpp"
+#include "test_printers.hpp"
+
+#include "bench_utils.hpp"
+#include "BenchClient.hpp"
+
+TEST_CASE("tick time vs active players share", "[bench][active]")
+{
+    GameCfg cfg;
+    cfg.worldCX = 1024;
+    cfg.worldCY = 1024;
+
+    const auto playersCount = 50000;
+    const auto ticksCount = 100;
+
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> randDir{0, DirCount - 1};
+
+    Game game{cfg};
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    for (auto&& pt : randomPoints(cfg.worldCX, cfg.worldCY, playersCount, rng))
+        clients.push_back(std::make_unique<BenchClient>(game, "bot", pt));
+
+    benchOut() << "active players    us/tick\n";
+
+    for (auto activeCount : {0, 50, 500, 5000, 50000})
+    {
+        auto totalUs = 0.0;
+        for (auto tick = 0; tick != ticksCount; ++tick)
+        {
+            for (auto n = 0; n != activeCount; ++n)
+                clients[n]->requestMove(static_cast<Dir>(randDir(rng)));
+
+            Stopwatch sw;
+            game.tick();
+            totalUs += sw.elapsedUs();
+        }
+
+        benchOut() << std::setw(14) << activeCount << std::setw(11) << totalUs / ticksCount << '\n';
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "math.hpp"
+
+struct Stopwatch
+{
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point m_start{clock::now()};
+
+    void restart() { m_start = clock::now(); }
+
+    double elapsedUs() const
+    {
+        return std::chrono::duration<double, std::micro>(clock::now() - m_start).count();
+    }
+};
+
+// returns `count` distinct random points inside cx * cy
+inline std::vector<Point> randomPoints(int cx, int cy, int count, std::mt19937& rng)
+{
+    assert(count <= cx * cy);
+    std::uniform_int_distribution<int> randX{0, cx - 1}, randY{0, cy - 1};
+
+    std::unordered_set<Point> taken;
+    std::vector<Point> points;
+    while ((int)points.size() != count)
+    {
+        Point pt{randX(rng), randY(rng)};
+        if (taken.insert(pt).second)
+            points.push_back(pt);
+    }
+
+    return points;
+}
+
+inline std::ostream& benchOut()
+{
+    return std::cout << std::fixed << std::setprecision(2);
+}
@@ -0,0 +1,66 @@
+#include "Game.hpp"
+
+#include "catch.hpp"
+#include "test_printers.hpp"
+
+#include "bench_utils.hpp"
+#include "BenchClient.hpp"
+
+TEST_CASE("tick time vs players count on a large map", "[bench][interest]")
+{
+    GameCfg cfg;
+    cfg.worldCX = 2048;
+    cfg.worldCY = 2048;
+    cfg.playerViewRadius = 8;
+    cfg.castTicks = 2;
+
+    const auto ticksCount = 100;
+
+    benchOut() << "players    us/tick    ns/player/tick    events/tick\n";
+
+    for (auto playersCount : {1000, 2000, 4000, 8000, 16000, 32000})
+    {
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<int> randDir{0, DirCount - 1};
+        std::uniform_int_distribution<int> randAction{0, 3};
+
+        Game game{cfg};
+        std::vector<std::unique_ptr<BenchClient>> clients;
+        for (auto&& pt : randomPoints(cfg.worldCX, cfg.worldCY, playersCount, rng))
+            clients.push_back(std::make_unique<BenchClient>(game, "bot", pt));
+
+        auto&& countEvents = [&]
+        {
+            auto n = 0ull;
+            for (auto&& c : clients)
+                n += c->m_eventsCount;
+            return n;
+        };
+
+        auto eventsBefore = countEvents();
+        auto totalUs = 0.0;
+        for (auto tick = 0; tick != ticksCount; ++tick)
+        {
+            for (auto&& c : clients)
+            {
+                if (randAction(rng) == 0)
+                    c->requestCast(Spell::SelfHeal, {});
+                else
+                    c->requestMove(static_cast<Dir>(randDir(rng)));
+            }
+
+            Stopwatch sw;
+            game.tick();
+            totalUs += sw.elapsedUs();
+        }
+        auto us = totalUs / ticksCount;
+        auto eventsPerTick = double(countEvents() - eventsBefore) / ticksCount;
+
+        CHECK(eventsPerTick > 0);
+
+        benchOut() << std::setw(7) << playersCount
+            << std::setw(11) << us
+            << std::setw(18) << us * 1000 / playersCount
+            << std::setw(15) << eventsPerTick << '\n';
+    }
+}
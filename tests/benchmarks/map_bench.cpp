@@ -0,0 +1,66 @@
+#include "Geodata.hpp"
+#include "MapFile.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+#include "catch.hpp"
+
+#include "bench_utils.hpp"
+
+TEST_CASE("map load time on 4096x4096, text parse vs mapped binary", "[bench][map]")
+{
+    const auto cx = 4096, cy = 4096;
+    const auto path = "map_bench.map";
+
+    std::mt19937 rng{5};
+    std::uniform_int_distribution<int> cellType{0, 63};
+    std::string text(cx * cy, '.');
+    for (auto&& c : text)
+    {
+        auto r = cellType(rng);
+        c = r < 8 ? 'W' : r == 8 ? '?' : '.';
+    }
+
+    std::vector<std::uint64_t> image;
+    REQUIRE(MapFile::encodeTextMap(cx, text, image));
+    {
+        std::ofstream out{path, std::ios::binary};
+        out.write(reinterpret_cast<const char*>(image.data()), image.size() * sizeof(image[0]));
+    }
+
+    benchOut() << "text: " << text.size() / 1024 << " KiB, binary: " << image.size() * 8 / 1024 << " KiB\n";
+
+    // the text parse Server::parseMap used to do
+    Stopwatch sw;
+    World textWorld{cx, cy};
+    Geodata textGeodata{textWorld};
+    std::vector<Point> textSpawns;
+    auto cellIdx = 0;
+    for (auto y = 0; y != cy; ++y)
+    {
+        for (auto x = 0; x != cx; ++x, ++cellIdx)
+        {
+            switch (text[cellIdx])
+            {
+            case 'W': textGeodata.addWall({x, y}); break;
+            case '?': textSpawns.emplace_back(x, y); break;
+            }
+        }
+    }
+    benchOut() << "text parse: " << sw.elapsedUs() / 1000 << " ms\n";
+
+    sw.restart();
+    MapFile map;
+    REQUIRE(map.open(path));
+    World world{cx, cy};
+    Geodata geodata{world};
+    geodata.loadWalls(map);
+    auto spawns = map.spawns();
+    benchOut() << "mapped binary: " << sw.elapsedUs() / 1000 << " ms\n";
+
+    CHECK(spawns == textSpawns);
+    CHECK(world.canMove({0, 0}, Dir::Right) == textWorld.canMove({0, 0}, Dir::Right));
+
+    std::remove(path);
+}
@@ -0,0 +1,157 @@
+#include "server/BinaryPacketBuilder.hpp"
+#include "server/PacketBuilder.hpp"
+
+#include <sstream>
+
+#include "catch.hpp"
+
+#include "bench_utils.hpp"
+
+namespace
+{
+    // the stringstream serializer PacketBuilder replaced
+    class StreamPacketBuilder
+    {
+    public:
+        explicit StreamPacketBuilder(const char* type)
+        {
+            ss << "{\"type\":\"" << type << '"';
+        }
+
+        StreamPacketBuilder& field(const char* name, int value)
+        {
+            ss << ",\"" << name << "\":" << value;
+            return *this;
+        }
+
+        StreamPacketBuilder& field(const char* name, ObjectId id)
+        {
+            ss << ",\"" << name << "\":" << id.value;
+            return *this;
+        }
+
+        StreamPacketBuilder& field(const char* name, const std::string& value)
+        {
+            ss << ",\"" << name << "\":\"" << value << '"';
+            return *this;
+        }
+
+        std::string close()
+        {
+            ss << '}';
+            return ss.str();
+        }
+
+    private:
+        std::stringstream ss;
+    };
+
+    template<typename Builder, typename Sink>
+    void seePlayer(unsigned n, const std::string& name, Sink&& sink)
+    {
+        Builder p("see_player");
+        p.field("id", ObjectId{n});
+        p.field("dir", 2);
+        p.field("state", 1);
+        p.field("x", static_cast<int>(n % 4096));
+        p.field("y", static_cast<int>(n / 4096));
+        p.field("name", name);
+        sink(p.close());
+    }
+
+    template<typename Builder, typename Sink>
+    void seeBeginMove(unsigned n, Sink&& sink)
+    {
+        Builder p("see_begin_move");
+        p.field("id", ObjectId{n});
+        p.field("dir", static_cast<int>(n % 4));
+        sink(p.close());
+    }
+}
+
+TEST_CASE("packet serializer, stringstream vs pooled buffer", "[bench][packets]")
+{
+    const auto packetsCount = 1000000u;
+    const std::string name = "player_12345";
+
+    // both sinks append to a frame, as Connection does
+    std::string frame;
+    frame.reserve(128);
+    auto streamSink = [&](const std::string& packet) { frame.assign(packet); };
+    auto pooledSink = [&](PacketView packet) { frame.assign(packet.m_data, packet.m_size); };
+
+    Stopwatch sw;
+    for (auto n = 0u; n != packetsCount; ++n)
+        seePlayer<StreamPacketBuilder>(n, name, streamSink);
+    auto streamSeePlayer = sw.elapsedUs();
+    auto streamBytes = frame;
+
+    sw.restart();
+    for (auto n = 0u; n != packetsCount; ++n)
+        seePlayer<PacketBuilder>(n, name, pooledSink);
+    auto pooledSeePlayer = sw.elapsedUs();
+    CHECK(frame == streamBytes);
+
+    sw.restart();
+    for (auto n = 0u; n != packetsCount; ++n)
+        seeBeginMove<StreamPacketBuilder>(n, streamSink);
+    auto streamBeginMove = sw.elapsedUs();
+    streamBytes = frame;
+
+    sw.restart();
+    for (auto n = 0u; n != packetsCount; ++n)
+        seeBeginMove<PacketBuilder>(n, pooledSink);
+    auto pooledBeginMove = sw.elapsedUs();
+    CHECK(frame == streamBytes);
+
+    benchOut() << "see_player: stringstream " << streamSeePlayer * 1000 / packetsCount
+        << " ns, pooled " << pooledSeePlayer * 1000 / packetsCount << " ns\n";
+    benchOut() << "see_begin_move: stringstream " << streamBeginMove * 1000 / packetsCount
+        << " ns, pooled " << pooledBeginMove * 1000 / packetsCount << " ns\n";
+}
+
+TEST_CASE("packet protocol, JSON vs binary", "[bench][packets]")
+{
+    const auto packetsCount = 1000000u;
+    const std::string name = "player_12345";
+
+    // ids as the ObjectManager hands them out: small index, a version in the high bits
+    auto idOf = [](unsigned n) { ObjectId id{n % 10000}; return id; };
+
+    std::size_t jsonBytes = 0, binaryBytes = 0;
+    auto jsonSink = [&](PacketView packet) { jsonBytes += packet.m_size + 1; }; // and a ',' in the frame
+    auto binarySink = [&](PacketView packet) { binaryBytes += packet.m_size; };
+
+    Stopwatch sw;
+    for (auto n = 0u; n != packetsCount; ++n)
+    {
+        PacketBuilder p(PacketType::SeePlayer);
+        p.field("id", idOf(n)).field("dir", 2).field("state", 1);
+        p.field("x", static_cast<int>(n % 4096)).field("y", static_cast<int>(n / 4096)).field("name", name);
+        jsonSink(p.close());
+
+        PacketBuilder m(PacketType::SeeBeginMove);
+        m.field("id", idOf(n)).field("dir", static_cast<int>(n % 4));
+        jsonSink(m.close());
+    }
+    auto jsonUs = sw.elapsedUs();
+
+    sw.restart();
+    for (auto n = 0u; n != packetsCount; ++n)
+    {
+        BinaryPacketBuilder p(PacketType::SeePlayer);
+        p.id(idOf(n)).u8(2).u8(1).i32(static_cast<int>(n % 4096)).i32(static_cast<int>(n / 4096)).str(name);
+        binarySink(p.close());
+
+        BinaryPacketBuilder m(PacketType::SeeBeginMove);
+        m.id(idOf(n)).u8(static_cast<std::uint8_t>(n % 4));
+        binarySink(m.close());
+    }
+    auto binaryUs = sw.elapsedUs();
+
+    benchOut() << "see_player + see_begin_move: JSON " << jsonUs * 1000 / packetsCount << " ns, "
+        << double(jsonBytes) / packetsCount << " bytes; binary " << binaryUs * 1000 / packetsCount << " ns, "
+        << double(binaryBytes) / packetsCount << " bytes\n";
+
+    CHECK(binaryBytes < jsonBytes);
+}
@@ -0,0 +1,103 @@
+#include "BlockScheduler.hpp"
+
+#include "catch.hpp"
+
+#include "bench_utils.hpp"
+
+namespace
+{
+    // every 3rd slot is free and slots [2000, 4000) are a crowded cell
+    int itemCost(unsigned idx)
+    {
+        if (idx % 3 == 0)
+            return 0;
+        return (idx >= 2000 && idx < 4000) ? 200 : 2;
+    }
+
+    volatile unsigned g_sink;
+
+    void doWork(unsigned idx)
+    {
+        auto x = idx;
+        for (auto n = itemCost(idx) * 50; n != 0; --n)
+            x = x * 1664525 + 1013904223;
+        g_sink = x;
+    }
+
+    void printStats(const char* title, const WorkerStatsArray& stats, unsigned threadsCount, double us)
+    {
+        benchOut() << title << ": " << us << " us/phase\n";
+        for (auto threadIdx = 0u; threadIdx != threadsCount; ++threadIdx)
+        {
+            auto&& st = stats[threadIdx];
+            benchOut() << "  worker " << threadIdx
+                << ": utilisation " << st.utilisation() * 100 << "%"
+                << ", items " << st.m_items
+                << ", blocks " << st.m_blocks
+                << ", steals " << st.m_steals << '\n';
+        }
+    }
+}
+
+TEST_CASE("work-stealing vs fixed blocks on uneven load", "[bench][workers]")
+{
+    const auto n = 20000u;
+    const auto phasesCount = 20;
+
+    WorkerPool pool{MaxThreads};
+
+    SECTION("fixed blocks")
+    {
+        WorkerStatsArray stats{};
+        auto totalUs = 0.0;
+
+        for (auto phase = 0; phase != phasesCount; ++phase)
+        {
+            std::atomic<unsigned> nextBlockBase{0};
+            Stopwatch phaseSw;
+
+            pool.run([&](ThrdIdx threadIdx)
+            {
+                Stopwatch sw;
+                for (;;)
+                {
+                    auto blockBase = nextBlockBase.fetch_add(ThreadBlockSize);
+                    if (blockBase >= n)
+                        break;
+
+                    auto last = std::min(blockBase + ThreadBlockSize, n);
+                    for (auto idx = blockBase; idx != last; ++idx)
+                        doWork(idx);
+
+                    ++stats[threadIdx].m_blocks;
+                    stats[threadIdx].m_items += last - blockBase;
+                }
+                stats[threadIdx].m_busyNs += std::uint64_t(sw.elapsedUs() * 1000);
+            });
+
+            auto phaseUs = phaseSw.elapsedUs();
+            totalUs += phaseUs;
+            for (auto&& st : stats)
+                st.m_wallNs += std::uint64_t(phaseUs * 1000);
+        }
+
+        printStats("fixed blocks", stats, pool.threadsCount(), totalUs / phasesCount);
+    }
+
+    SECTION("work-stealing")
+    {
+        BlockScheduler scheduler;
+        Stopwatch sw;
+
+        for (auto phase = 0; phase != phasesCount; ++phase)
+        {
+            scheduler.run(pool, n, [&](unsigned base, unsigned count, ThrdIdx)
+            {
+                for (auto idx = base; idx != base + count; ++idx)
+                    doWork(idx);
+            });
+        }
+
+        printStats("work-stealing", scheduler.stats(), pool.threadsCount(), sw.elapsedUs() / phasesCount);
+    }
+}
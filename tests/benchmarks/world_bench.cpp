@@ -0,0 +1,100 @@
+#include "World.hpp"
+
+#include "catch.hpp"
+
+#include "bench_utils.hpp"
+
+TEST_CASE("cell table memory and query latency on 4096x4096", "[bench][world]")
+{
+    const auto cx = 4096, cy = 4096;
+    const auto objectsCount = cx * cy / 16;
+    const auto queriesCount = 1000000;
+    const auto viewRadius = 8;
+
+    std::mt19937 rng{42};
+
+    World world{cx, cy};
+    auto objects = randomPoints(cx, cy, objectsCount, rng);
+    for (auto n = 0u; n != objects.size(); ++n)
+        world.addObject(ObjectId{n}, objects[n]);
+
+    std::uniform_int_distribution<int> randX{0, cx - 1}, randY{0, cy - 1};
+    std::vector<Point> queries;
+    for (auto n = 0; n != queriesCount; ++n)
+        queries.emplace_back(randX(rng), randY(rng));
+
+    benchOut() << "memory: " << double(world.memoryUsage()) / (double(cx) * cy) << " bytes/cell\n";
+
+    Stopwatch sw;
+    auto found = 0u;
+    for (auto&& pt : queries)
+        found += world.objectAt(pt) != World::NoObject;
+    benchOut() << "objectAt: " << sw.elapsedUs() * 1000 / queriesCount << " ns/query\n";
+
+    sw.restart();
+    auto seen = 0u;
+    for (auto n = 0; n != queriesCount / 10; ++n)
+        world.forObjectsAround(queries[n], viewRadius, [&](World::Handle) { ++seen; });
+    benchOut() << "forObjectsAround(r=" << viewRadius << "): "
+        << sw.elapsedUs() * 1000 / (queriesCount / 10) << " ns/query, "
+        << double(seen) / (queriesCount / 10) << " objects/query\n";
+
+    CHECK(found > 0);
+    CHECK(seen > 0);
+}
+
+TEST_CASE("canMove latency on 4096x4096 with walls", "[bench][world]")
+{
+    const auto cx = 4096, cy = 4096;
+    const auto objectsCount = cx * cy / 16;
+    const auto wallsCount = cx * cy / 16;
+    const auto queriesCount = 4000000;
+
+    std::mt19937 rng{7};
+
+    World world{cx, cy};
+    auto points = randomPoints(cx, cy, objectsCount + wallsCount, rng);
+    for (auto n = 0; n != objectsCount; ++n)
+        world.addObject(ObjectId{unsigned(n)}, points[n]);
+    for (auto n = objectsCount; n != objectsCount + wallsCount; ++n)
+        world.addWall(points[n]);
+
+    std::uniform_int_distribution<int> randX{0, cx - 1}, randY{0, cy - 1}, randDir{0, DirCount - 1};
+    std::vector<std::pair<Point, Dir>> queries;
+    for (auto n = 0; n != queriesCount; ++n)
+        queries.emplace_back(Point{randX(rng), randY(rng)}, static_cast<Dir>(randDir(rng)));
+
+    Stopwatch sw;
+    auto allowed = 0u;
+    for (auto&& q : queries)
+        allowed += world.canMove(q.first, q.second);
+    benchOut() << "canMove: " << sw.elapsedUs() * 1000 / queriesCount << " ns/query, "
+        << 100.0 * allowed / queriesCount << "% allowed\n";
+
+    CHECK(allowed > 0);
+    CHECK(allowed < unsigned{queriesCount});
+}
+
+TEST_CASE("sparse world memory on 100000x100000 with clustered players", "[bench][world]")
+{
+    const auto cx = 100000, cy = 100000;
+    const auto clusterSize = 512;
+    const auto objectsCount = 4 * clusterSize * clusterSize / 16;
+
+    std::mt19937 rng{11};
+
+    World world{cx, cy};
+    benchOut() << "empty world: " << world.memoryUsage() / (1 << 20) << " MiB\n";
+
+    // four populated areas in the corners and the middle of the map
+    const Point origins[] = {{0, 0}, {cx - clusterSize, 0}, {cx / 2, cy / 2}, {0, cy - clusterSize}};
+    auto n = 0u;
+    for (auto&& origin : origins)
+        for (auto&& pt : randomPoints(clusterSize, clusterSize, objectsCount / 4, rng))
+            world.addObject(ObjectId{n++}, {origin.x + pt.x, origin.y + pt.y});
+
+    benchOut() << "populated: " << world.memoryUsage() / (1 << 20) << " MiB, "
+        << world.allocatedChunks() << " chunks\n";
+
+    CHECK(world.allocatedChunks() < 4u * (clusterSize / 64 + 2) * (clusterSize / 64 + 2));
+}
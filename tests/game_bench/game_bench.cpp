@@ -0,0 +1,312 @@
+// Headless load benchmark: N scripted bots against Game on a generated map.
+//
+// game_bench [--size 1024] [--players 1000,10000,50000] [--threads 1,2,4]
+//            [--ticks 200] [--warmup 20] [--seed 42] [--phases]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Game.hpp"
+#include "MapFile.hpp"
+#include "TickProfiler.hpp"
+
+namespace
+{
+    struct Options
+    {
+        int m_size{1024};
+        std::vector<int> m_players{1000, 10000, 50000};
+        std::vector<int> m_threads{1, 2, 4};
+        int m_ticks{200};
+        int m_warmup{20};
+        unsigned m_seed{42};
+        bool m_phases{false};
+    };
+
+    std::vector<int> parseList(const std::string& text)
+    {
+        std::vector<int> values;
+        std::istringstream is{text};
+        std::string item;
+        while (std::getline(is, item, ','))
+            values.push_back(std::atoi(item.c_str()));
+        return values;
+    }
+
+    bool parseArgs(int argc, char* argv[], Options& opt)
+    {
+        for (auto i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--phases")
+            {
+                opt.m_phases = true;
+                continue;
+            }
+
+            if (i + 1 == argc)
+                return false;
+
+            std::string value = argv[++i];
+            if (arg == "--size") opt.m_size = std::atoi(value.c_str());
+            else if (arg == "--players") opt.m_players = parseList(value);
+            else if (arg == "--threads") opt.m_threads = parseList(value);
+            else if (arg == "--ticks") opt.m_ticks = std::atoi(value.c_str());
+            else if (arg == "--warmup") opt.m_warmup = std::atoi(value.c_str());
+            else if (arg == "--seed") opt.m_seed = static_cast<unsigned>(std::atoi(value.c_str()));
+            else return false;
+        }
+
+        return opt.m_size > 0 && opt.m_ticks > 0 && opt.m_warmup >= 0;
+    }
+
+    // Scattered horizontal and vertical wall segments, about 10% of the cells.
+    std::string generateMap(int size, std::mt19937& rng)
+    {
+        std::string cells(static_cast<std::size_t>(size) * size, '.');
+        std::uniform_int_distribution<int> randPos{0, size - 1}, randLen{3, 12}, randBool{0, 1};
+
+        auto segmentsCount = size * size / 75;
+        for (auto n = 0; n != segmentsCount; ++n)
+        {
+            auto x = randPos(rng), y = randPos(rng), len = randLen(rng);
+            auto horizontal = randBool(rng) != 0;
+            for (auto i = 0; i != len && x < size && y < size; ++i)
+            {
+                cells[static_cast<std::size_t>(y) * size + x] = 'W';
+                (horizontal ? x : y) += 1;
+            }
+        }
+
+        return cells;
+    }
+
+    enum class Script { Walker, Caster, Idle };
+
+    // Tracks its own position from its own events and counts everything it
+    // receives. Events may come from several worker threads at once.
+    struct Bot : EventHandler
+    {
+        Bot(Script script, unsigned seed) : m_script{script}, m_seed{seed} {}
+
+        Script m_script;
+        unsigned m_seed;
+        ObjectId m_id;
+        Point m_pos;
+        Dir m_moveDir{};
+        int m_health{100};
+        bool m_dead{false};
+        std::atomic<unsigned long long> m_eventsCount{0};
+
+        // one scripted command per tick, Game drops the ones that come too early
+        void act(Game& game, int tick, int size)
+        {
+            if (m_dead)
+                return;
+
+            ActionData ad{};
+            ad.m_castDest = m_pos;
+            switch (m_script)
+            {
+            case Script::Walker:
+                ad.m_action = Action::Move;
+                ad.m_moveDir = static_cast<Dir>((m_seed + tick / 16) % DirCount);
+                break;
+
+            case Script::Caster:
+                if ((tick + m_seed) % 4 != 0)
+                    return;
+
+                ad.m_action = Action::Cast;
+                if (m_health < 50)
+                {
+                    ad.m_spell = Spell::SelfHeal;
+                }
+                else
+                {
+                    ad.m_spell = Spell::Lightning;
+                    ad.m_castDest = moveRel(moveRel(m_pos, static_cast<Dir>((m_seed + tick) % DirCount)),
+                        static_cast<Dir>((m_seed + tick / 4) % DirCount));
+                    ad.m_castDest.x = std::min(std::max(ad.m_castDest.x, 0), size - 1);
+                    ad.m_castDest.y = std::min(std::max(ad.m_castDest.y, 0), size - 1);
+                }
+                break;
+
+            case Script::Idle:
+                return;
+            }
+
+            game.enqueueAction(m_id, ad);
+        }
+
+    private:
+        void count() { m_eventsCount.fetch_add(1, std::memory_order_relaxed); }
+
+        virtual void init(const InitInfo& info) override { m_id = info.m_id; m_pos = info.m_pos; count(); }
+        virtual void seePlayer(const FullPlayerInfo&) override { count(); }
+        virtual void disconnect() override { m_dead = true; count(); }
+        virtual void seeDisappear(ObjectId) override { count(); }
+
+        virtual void seeBeginMove(const MoveInfo& info) override
+        {
+            if (info.id == m_id)
+                m_moveDir = info.moveDir;
+            count();
+        }
+
+        virtual void seeCrossCellBorder(ObjectId id) override
+        {
+            if (id == m_id)
+                m_pos = moveRel(m_pos, m_moveDir);
+            count();
+        }
+
+        virtual void seeStop(ObjectId) override { count(); }
+        virtual void seeBeginCast(const CastInfo&) override { count(); }
+        virtual void seeEndCast(ObjectId) override { count(); }
+        virtual void seeEffect(const SpellEffect&) override { count(); }
+        virtual void healthChange(int newHP) override { m_health = newHP; count(); }
+    };
+
+    struct RunResult
+    {
+        LatencyHistogram m_tickNs;
+        TickProfiler m_phases;
+        double m_totalUs{0};
+        unsigned long long m_events{0};
+        int m_dead{0};
+    };
+
+    RunResult run(const Options& opt, const MapFile& map, const std::vector<Point>& spawns,
+        int playersCount, unsigned threadsCount)
+    {
+        GameCfg cfg;
+        cfg.worldCX = opt.m_size;
+        cfg.worldCY = opt.m_size;
+        cfg.playerViewRadius = 8;
+        cfg.moveTicks = 4;
+        cfg.castTicks = 4;
+        cfg.spellHpDelta = {{-10, +26}};
+        cfg.threadsCount = threadsCount;
+
+        Game game{cfg};
+        game.m_geodata.loadWalls(map);
+
+        // 60% walkers, 20% casters, 20% idle
+        std::vector<std::unique_ptr<Bot>> bots;
+        for (auto n = 0; n != playersCount; ++n)
+        {
+            auto script = n % 5 < 3 ? Script::Walker : n % 5 == 3 ? Script::Caster : Script::Idle;
+            bots.push_back(std::make_unique<Bot>(script, static_cast<unsigned>(n) * 2654435761u >> 8));
+            game.newPlayer(*bots.back(), spawns[n], "bot");
+        }
+
+        RunResult result;
+        for (auto tick = 0; tick != opt.m_warmup + opt.m_ticks; ++tick)
+        {
+            if (tick == opt.m_warmup)
+            {
+                game.profiler().reset();
+                for (auto&& bot : bots)
+                    bot->m_eventsCount = 0;
+            }
+
+            for (auto&& bot : bots)
+                bot->act(game, tick, opt.m_size);
+
+            auto start = TickProfiler::Clock::now();
+            game.tick();
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TickProfiler::Clock::now() - start).count();
+
+            if (tick >= opt.m_warmup)
+            {
+                result.m_tickNs.record(static_cast<std::uint64_t>(ns));
+                result.m_totalUs += ns / 1000.0;
+            }
+        }
+
+        for (auto&& bot : bots)
+        {
+            result.m_events += bot->m_eventsCount;
+            result.m_dead += bot->m_dead;
+        }
+
+        result.m_phases = game.profiler();
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "usage: game_bench [--size N] [--players N,N,...] [--threads N,N,...]"
+            " [--ticks N] [--warmup N] [--seed N] [--phases]\n";
+        return 1;
+    }
+
+    std::mt19937 rng{opt.m_seed};
+    MapFile map;
+    if (!map.fromText(opt.m_size, generateMap(opt.m_size, rng)))
+    {
+        std::cerr << "failed to build the map\n";
+        return 1;
+    }
+
+    // distinct free cells, shared by all runs so they differ only in N and threads
+    auto maxPlayers = *std::max_element(opt.m_players.begin(), opt.m_players.end());
+    if (maxPlayers > opt.m_size * opt.m_size / 2)
+    {
+        std::cerr << "too many players for a " << opt.m_size << "x" << opt.m_size << " map\n";
+        return 1;
+    }
+
+    std::vector<Point> spawns;
+    std::unordered_set<Point> taken;
+    std::uniform_int_distribution<int> randPos{0, opt.m_size - 1};
+    while ((int)spawns.size() != maxPlayers)
+    {
+        Point pt{randPos(rng), randPos(rng)};
+        if (!map.isWall(pt) && taken.insert(pt).second)
+            spawns.push_back(pt);
+    }
+
+    std::cout << "map " << opt.m_size << "x" << opt.m_size << ", "
+        << opt.m_ticks << " ticks after " << opt.m_warmup << " warm-up ticks\n";
+    std::cout << std::setw(8) << "players" << std::setw(8) << "threads"
+        << std::setw(11) << "ticks/s"
+        << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "max us"
+        << std::setw(13) << "events/tick" << std::setw(7) << "dead" << '\n';
+
+    for (auto playersCount : opt.m_players)
+    {
+        for (auto threadsCount : opt.m_threads)
+        {
+            if (threadsCount < 1 || threadsCount > MaxThreads)
+                continue;
+
+            auto r = run(opt, map, spawns, playersCount, static_cast<unsigned>(threadsCount));
+            std::cout << std::fixed << std::setprecision(1)
+                << std::setw(8) << playersCount << std::setw(8) << threadsCount
+                << std::setw(11) << opt.m_ticks / (r.m_totalUs / 1e6)
+                << std::setw(10) << r.m_tickNs.percentile(50) / 1000.0
+                << std::setw(10) << r.m_tickNs.percentile(99) / 1000.0
+                << std::setw(10) << r.m_tickNs.max() / 1000.0
+                << std::setw(13) << double(r.m_events) / opt.m_ticks
+                << std::setw(7) << r.m_dead << '\n';
+
+            if (opt.m_phases)
+                r.m_phases.print(std::cout);
+        }
+    }
+}
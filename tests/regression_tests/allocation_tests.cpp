@@ -0,0 +1,96 @@
+#include "Game.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "catch.hpp"
+#include "test_printers.hpp"
+
+#include "test_game_config.hpp"
+#include "TestClient.hpp"
+
+namespace
+{
+    std::atomic<bool> g_countAllocations{false};
+    std::atomic<int> g_allocationsCount{0};
+
+    struct AllocationCounter
+    {
+        AllocationCounter()
+        {
+            g_allocationsCount = 0;
+            g_countAllocations = true;
+        }
+
+        ~AllocationCounter() { g_countAllocations = false; }
+
+        int stop()
+        {
+            g_countAllocations = false;
+            return g_allocationsCount;
+        }
+    };
+}
+
+void* operator new(std::size_t size)
+{
+    if (g_countAllocations)
+        ++g_allocationsCount;
+
+    if (auto ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+TEST_CASE("move cycle does not allocate", "[game][alloc]")
+{
+    Game game{TestGameCfg};
+    TestClient A{game, "A", {1, 1}};
+
+    auto&& moveCycle = [&](Dir dir)
+    {
+        A.requestMove(dir);
+        game.tick();
+        game.tick();
+        game.tick();
+    };
+
+    moveCycle(Dir::Right); // warm up the timer pool and the active lists
+
+    AllocationCounter allocations;
+    moveCycle(Dir::Left);
+    auto allocationsCount = allocations.stop();
+
+    REQUIRE(A.m_pos == Point(1, 1));
+    REQUIRE(A.m_state == PlayerState::Idle);
+    REQUIRE(allocationsCount == 0);
+}
+
+TEST_CASE("cast cycle does not allocate", "[game][alloc]")
+{
+    Game game{TestGameCfg};
+    TestClient A{game, "A", {1, 1}};
+
+    auto&& castCycle = [&]
+    {
+        A.requestCast(Spell::SelfHeal);
+        game.tick();
+        game.tick();
+    };
+
+    castCycle();
+
+    AllocationCounter allocations;
+    castCycle();
+    auto allocationsCount = allocations.stop();
+
+    REQUIRE(A.m_state == PlayerState::Idle);
+    REQUIRE(allocationsCount == 0);
+}
@@ -42,4 +42,37 @@ TEST_CASE("other disconnects far away", "[game]")
     B.requestDisconnect();
     game.tick();
     REQUIRE(A.seeNothing());
-}
\ No newline at end of file
+}
+
+TEST_CASE("mass disconnect compacts objects", "[game]")
+{
+    GameCfg cfg;
+    cfg.worldCX = 64;
+    cfg.worldCY = 64;
+    Game game{cfg};
+
+    std::vector<std::unique_ptr<TestClient>> clients;
+    for (auto y = 0; y != cfg.worldCY; y += 2)
+        for (auto x = 0; x != cfg.worldCX; ++x)
+            clients.push_back(std::make_unique<TestClient>(game, std::to_string(x) + ":" + std::to_string(y), Point{x, y}));
+
+    for (auto&& c : clients)
+    {
+        if (c->m_pos != Point(10, 10) && c->m_pos != Point(11, 10))
+            c->requestDisconnect();
+    }
+    game.tick();
+
+    auto&& A = *clients[5 * cfg.worldCX + 10];
+    auto&& B = *clients[5 * cfg.worldCX + 11];
+    REQUIRE(A.m_isConnected);
+    REQUIRE(B.m_isConnected);
+    REQUIRE(A.doSee(B.m_name));
+
+    A.requestMove(Dir::Down);
+    game.tick();
+    game.tick();
+    game.tick();
+    REQUIRE(A.m_pos == Point(10, 11));
+    REQUIRE(B.see(A.m_name).m_pos == Point(10, 11));
+}
@@ -1,10 +1,13 @@
 #include "server/Menu.hpp"
 #include "server/Server.hpp"
+#include "TickScheduler.hpp"
+
+#include <fstream>
 
 #define CATCH_CONFIG_RUNNER
 #include "catch.hpp"
 
-static void serverMain()
+static void serverMain(const std::string& journalPath)
 {
     auto worldMap =
         "........" // 0
@@ -18,22 +21,61 @@ static void serverMain()
         ;
 
     GameCfg cfg;
-    Server srv{cfg, worldMap};
+    cfg.moveTicks = cfg.ticksPerSecond;  // one cell per second
+    cfg.castTicks = cfg.ticksPerSecond;
+    MapFile map;
+    if (!map.fromText(cfg.worldCX, worldMap))
+    {
+        std::cout << "invalid world map\n";
+        return;
+    }
+
+    Server srv{cfg, map};
+    if (!srv.loadMap())
+    {
+        std::cout << "the map doesn't match the world size\n";
+        return;
+    }
+
+    if (!journalPath.empty() && !srv.startJournal(journalPath))
+    {
+        std::cout << "cannot write " << journalPath << '\n';
+        return;
+    }
+
     srv.start("127.0.0.1", 4080, std::cout);
     std::cout << "Press [q] to quit or [h] for help\n";
     
+    const auto ProfileLogTicks = 10u * cfg.ticksPerSecond;
+    std::ofstream profileLog{"tick_profile.log", std::ios::app};
+
     Menu menu;
-    for (;;)
+    TickScheduler scheduler{cfg.ticksPerSecond, cfg.maxCatchUpTicks};
+    scheduler.start();
+    auto ticksRun = 0u;
+    while (!menu.quitRequested())
     {
-        srv.tick();
-        menu.tick();
-        if (menu.quitRequested())
-            break;
+        for (auto n = scheduler.waitForTicks(); n != 0; --n)
+        {
+            srv.tick();
 
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+            if (++ticksRun % ProfileLogTicks == 0)
+            {
+                profileLog << "after " << ticksRun << " ticks, "
+                    << scheduler.overruns() << " overruns\n";
+                srv.printProfile(profileLog);
+                profileLog.flush();
+            }
+        }
+
+        menu.tick();
+        if (menu.profileRequested())
+            srv.printProfile(std::cout);
     }
 
-    std::cout << "stopping...\n";
+    std::cout << "stopping... " << scheduler.ticks() << " ticks, "
+        << scheduler.overruns() << " overruns, "
+        << scheduler.skipped() << " skipped\n";
     srv.stop();
 }
 
@@ -47,10 +89,19 @@ int main(int argc, char* argv[])
         argv[argc] = nullptr;
     }
 
+    // --journal <path> --run-server records the session for tools/replay
+    std::string journalPath;
+    if (runServer && argc > 2 && argv[argc - 2] == std::string("--journal"))
+    {
+        journalPath = argv[argc - 1];
+        argc -= 2;
+        argv[argc] = nullptr;
+    }
+
     auto result = Catch::Session().run(argc, argv);
 
     if (!runServer)
         return result;
 
-    serverMain();
+    serverMain(journalPath);
 }
@@ -54,4 +54,19 @@ TEST_CASE("spawn on occupied cell", "[game]")
     TestClient C{game, "C", {1, 1}};
     REQUIRE_FALSE(B.doSee("A"));
     REQUIRE(B.doSee("C"));
-}
\ No newline at end of file
+}
+
+TEST_CASE("spawn at view radius near world corner", "[game]")
+{
+    Game game{TestGameCfg};
+
+    TestClient A{game, "A", {0, 0}};
+    TestClient B{game, "B", {2, 0}};
+    TestClient C{game, "C", {1, 2}};
+
+    REQUIRE(A.doSee("B"));
+    REQUIRE_FALSE(A.doSee("C"));
+    REQUIRE(B.doSee("A"));
+    REQUIRE_FALSE(B.doSee("C"));
+    REQUIRE_FALSE(C.doSee("A"));
+}
@@ -0,0 +1,42 @@
+#include "BlockScheduler.hpp"
+
+#include <atomic>
+#include <memory>
+
+#include "catch.hpp"
+
+TEST_CASE("block size adapts to items and threads count", "[workers]")
+{
+    CHECK(BlockScheduler::blockSize(100, 4) == MinThreadBlockSize);
+    CHECK(BlockScheduler::blockSize(32 * 200, 4) == 200);
+    CHECK(BlockScheduler::blockSize(1000000, 2) == ThreadBlockSize);
+}
+
+TEST_CASE("block scheduler visits every index once", "[workers]")
+{
+    WorkerPool pool{MaxThreads};
+    BlockScheduler scheduler;
+
+    for (auto n : {0u, 1u, 63u, 1000u, 4097u, 100000u})
+    {
+        std::unique_ptr<std::atomic<int>[]> visits{new std::atomic<int>[n + 1]{}};
+
+        scheduler.run(pool, n, [&](unsigned base, unsigned count, ThrdIdx)
+        {
+            for (auto i = base; i != base + count; ++i)
+                ++visits[i];
+        });
+
+        auto allOnce = true;
+        for (auto i = 0u; i != n; ++i)
+            allOnce = allOnce && visits[i] == 1;
+
+        INFO("n = " << n);
+        REQUIRE(allOnce);
+    }
+
+    auto items = 0ull;
+    for (auto&& st : scheduler.stats())
+        items += st.m_items;
+    REQUIRE(items == 0ull + 1 + 63 + 1000 + 4097 + 100000);
+}
@@ -0,0 +1,61 @@
+#include "server/CommandParser.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+    // commands point into `msg`, so keep it a literal
+    std::vector<Command> parseAll(const char* msg)
+    {
+        CommandParser parser{msg, std::strlen(msg)};
+        std::vector<Command> commands;
+        Command cmd;
+        while (parser.next(cmd))
+            commands.push_back(cmd);
+        return commands;
+    }
+}
+
+TEST_CASE("single commands are parsed", "[commands]")
+{
+    auto move = parseAll("move 2");
+    REQUIRE(move.size() == 1u);
+    CHECK(move[0].m_verb == Command::Verb::Move);
+    CHECK(move[0].m_args[0] == 2);
+
+    auto cast = parseAll("cast 0 -3 17");
+    REQUIRE(cast.size() == 1u);
+    CHECK(cast[0].m_verb == Command::Verb::Cast);
+    CHECK(cast[0].m_args[1] == -3);
+    CHECK(cast[0].m_args[2] == 17);
+
+    auto proto = parseAll("proto binary");
+    REQUIRE(proto.size() == 1u);
+    CHECK(proto[0].m_verb == Command::Verb::Proto);
+    CHECK(proto[0].wordIs("binary"));
+    CHECK_FALSE(proto[0].wordIs("bin"));
+}
+
+TEST_CASE("several commands share one message", "[commands]")
+{
+    auto commands = parseAll("proto binary; move 1\nclose;;");
+    REQUIRE(commands.size() == 3u);
+    CHECK(commands[0].m_verb == Command::Verb::Proto);
+    CHECK(commands[1].m_verb == Command::Verb::Move);
+    CHECK(commands[2].m_verb == Command::Verb::Close);
+    CHECK(std::string(commands[1].m_text, commands[1].m_textSize) == "move 1");
+}
+
+TEST_CASE("malformed commands are invalid and don't stop the parser", "[commands]")
+{
+    auto commands = parseAll("jump 1;move;move x;move 1 2;cast 1 2;move 99999999999;close now;"
+        "move 4;move -1;cast 2 0 0;cast -1 0 0;move 3");
+    REQUIRE(commands.size() == 12u);
+    for (auto i = 0u; i != 11; ++i)
+        CHECK(commands[i].m_verb == Command::Verb::Invalid);
+    CHECK(commands[11].m_verb == Command::Verb::Move);
+}
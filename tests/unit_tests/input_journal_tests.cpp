@@ -0,0 +1,161 @@
+#include "InputJournal.hpp"
+#include "Replay.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+#include "test_printers.hpp"
+
+namespace
+{
+    const char* journalPath = "input_journal_test.tmp";
+
+    const char* testMap =
+        "........"
+        ".WW....."
+        "........"
+        "....W..."
+        "........"
+        "........"
+        "........"
+        "........";
+
+    ActionData move(Dir dir)
+    {
+        ActionData ad{};
+        ad.m_action = Action::Move;
+        ad.m_moveDir = dir;
+        return ad;
+    }
+
+    ActionData cast(Spell spell, Point dest)
+    {
+        ActionData ad{};
+        ad.m_action = Action::Cast;
+        ad.m_spell = spell;
+        ad.m_castDest = dest;
+        return ad;
+    }
+
+    // plays a short session into the journal, returns the events delivered
+    std::uint64_t recordSession(const GameCfg& cfg, const MapFile& map)
+    {
+        JournalWriter journal;
+        REQUIRE(journal.open(journalPath, cfg, &map));
+
+        Game game{cfg};
+        game.m_geodata.loadWalls(map);
+        game.setJournal(&journal);
+
+        ReplayClient::PlayerIds ids;
+        std::vector<std::unique_ptr<ReplayClient>> clients;
+        for (auto n = 0u; n != 3; ++n)
+        {
+            clients.push_back(std::make_unique<ReplayClient>(game, ids, n));
+            game.newPlayer(*clients.back(), {static_cast<int>(n) * 2, 2}, "p" + std::to_string(n));
+        }
+
+        game.enqueueAction(clients[0]->id(), move(Dir::Right));
+        game.enqueueAction(clients[2]->id(), cast(Spell::Lightning, {-1, 300}));
+        game.tick();
+        game.tick();
+        game.enqueueAction(clients[1]->id(), cast(Spell::Lightning, {2, 2}));
+        game.enqueueAction(clients[2]->id(), move(Dir::Up));
+        for (auto n = 0; n != 5; ++n)
+            game.tick();
+        game.enqueueAction(clients[1]->id(), ActionData{Action::Disconnect});
+        for (auto n = 0; n != 5; ++n)
+            game.tick();
+
+        std::uint64_t events = 0;
+        for (auto&& c : clients)
+            events += c->eventsCount();
+        return events;
+    }
+}
+
+TEST_CASE("journal records are read back in order", "[journal]")
+{
+    GameCfg cfg;
+    cfg.moveTicks = 2;
+    MapFile map;
+    REQUIRE(map.fromText(cfg.worldCX, testMap));
+    recordSession(cfg, map);
+
+    JournalReader journal;
+    REQUIRE(journal.open(journalPath));
+    REQUIRE(journal.hasMap());
+    CHECK(journal.map().isWall({4, 3}));
+
+    GameCfg loaded;
+    journal.loadCfg(loaded);
+    CHECK(loaded.moveTicks == 2);
+
+    JournalEntry e;
+    for (auto n = 0u; n != 3; ++n)
+    {
+        REQUIRE(journal.next(e));
+        CHECK(e.m_kind == JournalEntry::Kind::NewPlayer);
+        CHECK(e.m_tick == 0u);
+        CHECK(e.m_player == n);
+        CHECK(e.m_pos == Point(static_cast<int>(n) * 2, 2));
+        CHECK(e.m_name == "p" + std::to_string(n));
+    }
+
+    REQUIRE(journal.next(e));
+    CHECK(e.m_kind == JournalEntry::Kind::Action);
+    CHECK(e.m_player == 0u);
+    CHECK(e.m_action.m_action == Action::Move);
+    CHECK(e.m_action.m_moveDir == Dir::Right);
+
+    REQUIRE(journal.next(e));
+    CHECK(e.m_player == 2u);
+    CHECK(e.m_action.m_action == Action::Cast);
+    CHECK(e.m_action.m_castDest == Point(-1, 300));
+
+    REQUIRE(journal.next(e));
+    CHECK(e.m_tick == 2u);
+    CHECK(e.m_player == 1u);
+
+    REQUIRE(journal.next(e));
+    CHECK(e.m_tick == 2u);
+    CHECK(e.m_action.m_action == Action::Move);
+
+    REQUIRE(journal.next(e));
+    CHECK(e.m_tick == 7u);
+    CHECK(e.m_action.m_action == Action::Disconnect);
+
+    CHECK_FALSE(journal.next(e));
+    CHECK(journal.atEnd());
+
+    std::remove(journalPath);
+}
+
+TEST_CASE("replay delivers the recorded events", "[journal]")
+{
+    GameCfg cfg;
+    MapFile map;
+    REQUIRE(map.fromText(cfg.worldCX, testMap));
+    auto recordedEvents = recordSession(cfg, map);
+    REQUIRE(recordedEvents > 0);
+
+    std::uint64_t digests[2];
+    for (auto&& digest : digests)
+    {
+        JournalReader journal;
+        REQUIRE(journal.open(journalPath));
+        Replay replay{journal, cfg};
+        REQUIRE(replay.run(4));
+
+        CHECK(replay.playersCount() == 3u);
+        CHECK(replay.ticksCount() == 12u);
+        CHECK(replay.eventsCount() == recordedEvents);
+        digest = replay.digest();
+    }
+
+    CHECK(digests[0] == digests[1]);
+
+    std::remove(journalPath);
+}
@@ -0,0 +1,54 @@
+#include "server/MapChunks.hpp"
+
+#include "catch.hpp"
+
+TEST_CASE("map chunks around a point", "[map]")
+{
+    MapFile map;
+    REQUIRE(map.fromText(40, std::string(40 * 20, '.')));
+    MapChunks chunks{map};
+
+    std::vector<unsigned> around;
+    chunks.forChunksAround({0, 0}, [&](unsigned idx) { around.push_back(idx); });
+    CHECK(around == (std::vector<unsigned>{0, 1, 3, 4}));
+
+    around.clear();
+    chunks.forChunksAround({39, 19}, [&](unsigned idx) { around.push_back(idx); });
+    CHECK(around == (std::vector<unsigned>{1, 2, 4, 5}));
+}
+
+TEST_CASE("map chunk packets are encoded once and clipped to the map", "[map]")
+{
+    std::string text(20 * 18, '.');
+    text[17 * 20 + 19] = 'W';
+
+    MapFile map;
+    REQUIRE(map.fromText(20, text));
+    MapChunks chunks{map};
+
+    CHECK(chunks.headerPacket(false) == R"({"type":"map","cx":20,"cy":18})");
+
+    auto&& corner = chunks.packet(3, false);
+    CHECK(corner == R"({"type":"map_chunk","x":16,"y":16,"cx":4,"cells":".......W"})");
+    CHECK(&chunks.packet(3, false) == &corner);
+}
+
+TEST_CASE("binary map chunk packs walls into bits", "[map]")
+{
+    std::string text(20 * 18, '.');
+    text[17 * 20 + 19] = 'W';
+
+    MapFile map;
+    REQUIRE(map.fromText(20, text));
+    MapChunks chunks{map};
+
+    auto&& corner = chunks.packet(3, true);
+    const char expected[] = {
+        static_cast<char>(PacketType::MapChunk),
+        16, 0, 0, 0, 16, 0, 0, 0, // x, y
+        4, 0, 2, 0, // cx, cy
+        static_cast<char>(0x80),
+    };
+    CHECK(corner == std::string(expected, sizeof(expected)));
+    CHECK(&chunks.packet(3, true) == &corner);
+}
@@ -0,0 +1,107 @@
+#include "Geodata.hpp"
+#include "MapFile.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#include "catch.hpp"
+#include "test_printers.hpp"
+
+namespace
+{
+    const char* testMap =
+        ".?W"
+        "W.."
+        "..?"
+        "...";
+}
+
+TEST_CASE("text map is encoded into wall bits and spawns", "[map]")
+{
+    MapFile map;
+    REQUIRE(map.fromText(3, testMap));
+
+    CHECK(map.cx() == 3);
+    CHECK(map.cy() == 4);
+    CHECK(map.isWall({2, 0}));
+    CHECK(map.isWall({0, 1}));
+    CHECK_FALSE(map.isWall({1, 0}));
+    CHECK(map.spawns() == (std::vector<Point>{{1, 0}, {2, 2}}));
+
+    std::vector<Point> walls;
+    map.forEachWall([&](const Point& pt) { walls.push_back(pt); });
+    CHECK(walls == (std::vector<Point>{{2, 0}, {0, 1}}));
+}
+
+TEST_CASE("invalid text maps are rejected", "[map]")
+{
+    MapFile map;
+    CHECK_FALSE(map.fromText(3, "..W."));
+    CHECK_FALSE(map.fromText(2, "..x."));
+    CHECK_FALSE(map.fromText(2, ""));
+}
+
+TEST_CASE("map file is mapped and validated", "[map]")
+{
+    const auto path = "map_file_tests.map";
+    std::vector<std::uint64_t> image;
+    REQUIRE(MapFile::encodeTextMap(3, testMap, image));
+
+    {
+        std::ofstream out{path, std::ios::binary};
+        out.write(reinterpret_cast<const char*>(image.data()), image.size() * sizeof(image[0]));
+    }
+
+    MapFile map;
+    REQUIRE(map.open(path));
+    CHECK(map.cy() == 4);
+    CHECK(map.isWall({0, 1}));
+    CHECK(map.spawns().size() == 2u);
+
+    {
+        // truncated file
+        std::ofstream out{path, std::ios::binary};
+        out.write(reinterpret_cast<const char*>(image.data()), (image.size() - 1) * sizeof(image[0]));
+    }
+
+    MapFile truncated;
+    CHECK_FALSE(truncated.open(path));
+    CHECK_FALSE(truncated.open("no_such_file.map"));
+
+    // the last spawn moved out of the map
+    auto badSpawn = image;
+    MapSpawn outside{3, 2};
+    std::memcpy(&badSpawn.back(), &outside, sizeof(outside));
+    MapFile badSpawnMap;
+    CHECK_FALSE(badSpawnMap.fromImage(badSpawn));
+    CHECK(badSpawnMap.fromImage(image));
+
+    std::remove(path);
+}
+
+TEST_CASE("bulk wall loading matches per-wall addWall", "[map]")
+{
+    const auto cx = 200, cy = 130;
+    std::mt19937 rng{3};
+    std::bernoulli_distribution isWall{0.05};
+    std::string text;
+    for (auto i = 0; i != cx * cy; ++i)
+        text += isWall(rng) ? 'W' : '.';
+
+    MapFile map;
+    REQUIRE(map.fromText(cx, text));
+
+    World bulk{cx, cy}, single{cx, cy};
+    Geodata{bulk}.loadWalls(map);
+    map.forEachWall([&](const Point& pt) { single.addWall(pt); });
+
+    CHECK(bulk.allocatedChunks() == single.allocatedChunks());
+    auto mismatches = 0;
+    for (auto y = 0; y != cy; ++y)
+        for (auto x = 0; x != cx; ++x)
+            for (auto d = 0; d != DirCount; ++d)
+                mismatches += bulk.canMove({x, y}, Dir(d)) != single.canMove({x, y}, Dir(d));
+    CHECK(mismatches == 0);
+}
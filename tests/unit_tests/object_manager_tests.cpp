@@ -0,0 +1,93 @@
+#include "ObjectManager.hpp"
+
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+    std::vector<ObjectId> createObjects(ObjectManager& mgr, int count)
+    {
+        std::vector<ObjectId> ids;
+        for (auto n = 0; n != count; ++n)
+        {
+            auto& obj = mgr.newObject();
+            obj.m_name = std::to_string(n);
+            obj.pos() = {n, -n};
+            ids.push_back(obj.m_id);
+        }
+
+        return ids;
+    }
+
+    void eraseObject(ObjectManager& mgr, ObjectId id, ThrdIdx threadIdx = 0)
+    {
+        mgr.eraseObject(mgr.getObject(id), threadIdx);
+    }
+}
+
+TEST_CASE("erased object ids become stale", "[objects]")
+{
+    ObjectManager mgr{1};
+    auto ids = createObjects(mgr, 3);
+
+    eraseObject(mgr, ids[1]);
+    REQUIRE(mgr.findObject(ids[1]) == nullptr);
+
+    mgr.mergeErasedObjectsLists();
+    REQUIRE(mgr.liveCount() == 2);
+
+    auto& obj = mgr.newObject();
+    REQUIRE(obj.m_id != ids[1]);
+    REQUIRE(mgr.findObject(ids[1]) == nullptr);
+    REQUIRE(mgr.findObject(obj.m_id) != nullptr);
+    REQUIRE(mgr.slotsCount() == 3);
+}
+
+TEST_CASE("erased slots are reused", "[objects]")
+{
+    ObjectManager mgr{1};
+    auto ids = createObjects(mgr, 10);
+
+    for (auto n = 0; n != 10; n += 2)
+        eraseObject(mgr, ids[n], n % MaxThreads);
+    mgr.mergeErasedObjectsLists();
+
+    createObjects(mgr, 5);
+    REQUIRE(mgr.slotsCount() == 10);
+    REQUIRE(mgr.liveCount() == 10);
+}
+
+TEST_CASE("compaction packs objects and keeps ids", "[objects]")
+{
+    ObjectManager mgr{1};
+    auto count = int(3 * ObjectsChunkSize);
+    auto ids = createObjects(mgr, count);
+
+    for (auto n = 0; n != count; ++n)
+    {
+        if (n % 4 != 0)
+            eraseObject(mgr, ids[n]);
+    }
+    mgr.mergeErasedObjectsLists();
+
+    mgr.compactIfSparse();
+    REQUIRE(mgr.slotsCount() == mgr.liveCount());
+
+    auto visited = 0;
+    mgr.for_each([&](Object&) { ++visited; });
+    REQUIRE(visited == count / 4);
+
+    auto allFound = true;
+    for (auto n = 0; n < count; n += 4)
+    {
+        auto objPtr = mgr.findObject(ids[n]);
+        allFound = allFound && objPtr
+            && objPtr->asObject().m_name == std::to_string(n)
+            && objPtr->asObject().pos() == Point(n, -n);
+    }
+    REQUIRE(allFound);
+
+    createObjects(mgr, 10);
+    REQUIRE(mgr.liveCount() == count / 4 + 10);
+}
@@ -0,0 +1,46 @@
+#include "server/BinaryPacketBuilder.hpp"
+#include "server/PacketBuilder.hpp"
+
+#include <climits>
+
+#include "catch.hpp"
+
+TEST_CASE("packet builder writes integers", "[packets]")
+{
+    PacketBuilder p("t");
+    p.field("a", 0).field("b", -17).field("c", INT_MAX).field("d", INT_MIN);
+    p.field("e", std::uint64_t{1} << 53);
+    CHECK(p.close().str() == R"({"type":"t","a":0,"b":-17,"c":2147483647,"d":-2147483648,"e":9007199254740992})");
+}
+
+TEST_CASE("packet builder escapes strings", "[packets]")
+{
+    PacketBuilder p("t");
+    p.field("name", std::string{"a\"b\\c\nd\x01\xc3\xa9"});
+    CHECK(p.close().str() == "{\"type\":\"t\",\"name\":\"a\\\"b\\\\c\\nd\\u0001\xc3\xa9\"}");
+}
+
+TEST_CASE("nested packet builders use separate buffers", "[packets]")
+{
+    PacketBuilder outer("outer");
+    outer.field("x", 1);
+    {
+        PacketBuilder inner("inner");
+        CHECK(inner.close().str() == R"({"type":"inner"})");
+    }
+    CHECK(outer.close().str() == R"({"type":"outer","x":1})");
+}
+
+TEST_CASE("binary packet builder writes little-endian fields and varints", "[packets]")
+{
+    BinaryPacketBuilder p(PacketType::SeePlayer);
+    p.varint(1).varint(300).varint(std::uint64_t{1} << 53);
+    p.u8(7).u16(0x1234).i32(-2).str("ab");
+
+    const unsigned char expected[] = {
+        static_cast<unsigned char>(PacketType::SeePlayer),
+        0x01, 0xac, 0x02, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x10,
+        7, 0x34, 0x12, 0xfe, 0xff, 0xff, 0xff, 2, 'a', 'b',
+    };
+    CHECK(p.close().str() == std::string(reinterpret_cast<const char*>(expected), sizeof(expected)));
+}
@@ -0,0 +1,36 @@
+#include "server/PacketCache.hpp"
+
+#include "catch.hpp"
+
+TEST_CASE("broadcast packets are encoded once per event", "[packets]")
+{
+    PacketCache cache;
+    auto encodes = 0;
+    auto encode = [&](std::string& packet) { ++encodes; packet = "packet"; };
+
+    PacketKey stop{PacketType::SeeStop, ObjectId{1}, 0, 0, 0};
+    PacketKey otherStop{PacketType::SeeStop, ObjectId{2}, 0, 0, 0};
+    PacketKey endCast{PacketType::SeeEndCast, ObjectId{1}, 0, 0, 0};
+
+    auto&& first = cache.get(stop, encode);
+    CHECK(&cache.get(stop, encode) == &first);
+    CHECK(first == "packet");
+    CHECK(encodes == 1);
+
+    auto binaryStop = stop;
+    binaryStop.m_binary = true;
+
+    cache.get(otherStop, encode);
+    cache.get(endCast, encode);
+    cache.get(binaryStop, encode);
+    CHECK(encodes == 4);
+
+    cache.clear();
+    cache.get(binaryStop, encode);
+    CHECK(encodes == 5);
+
+    // another cache doesn't see this one's packets
+    PacketCache otherCache;
+    otherCache.get(binaryStop, encode);
+    CHECK(encodes == 6);
+}
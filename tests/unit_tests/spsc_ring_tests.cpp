@@ -0,0 +1,53 @@
+#include "SpscRing.hpp"
+
+#include <string>
+#include <thread>
+
+#include "catch.hpp"
+
+TEST_CASE("spsc ring is FIFO and bounded", "[spsc]")
+{
+    SpscRing<std::string, 4> ring;
+    CHECK(ring.freeSpace() == 4u);
+
+    for (auto i = 0; i != 4; ++i)
+        REQUIRE(ring.push(std::to_string(i)));
+    CHECK_FALSE(ring.push("overflow"));
+    CHECK(ring.freeSpace() == 0u);
+
+    std::string s;
+    REQUIRE(ring.pop(s));
+    CHECK(s == "0");
+    REQUIRE(ring.push("4"));
+
+    for (auto i = 1; i != 5; ++i)
+    {
+        REQUIRE(ring.pop(s));
+        CHECK(s == std::to_string(i));
+    }
+    CHECK_FALSE(ring.pop(s));
+}
+
+TEST_CASE("spsc ring passes items between threads in order", "[spsc]")
+{
+    const auto itemsCount = 200000u;
+    SpscRing<unsigned, 64> ring;
+
+    std::thread producer{[&]
+    {
+        for (auto i = 0u; i != itemsCount; )
+            if (ring.push(unsigned{i}))
+                ++i;
+    }};
+
+    auto outOfOrder = 0u;
+    for (auto expected = 0u; expected != itemsCount; )
+    {
+        unsigned item;
+        if (ring.pop(item))
+            outOfOrder += item != expected++;
+    }
+
+    producer.join();
+    CHECK(outOfOrder == 0u);
+}
@@ -0,0 +1,63 @@
+#include "TickProfiler.hpp"
+
+#include <sstream>
+
+#include "catch.hpp"
+
+TEST_CASE("latency histogram buckets are log-linear", "[tick_profiler]")
+{
+    for (auto v = 0u; v != 32; ++v)
+        CHECK(LatencyHistogram::highestInBucket(LatencyHistogram::bucketOf(v)) == v);
+
+    CHECK(LatencyHistogram::bucketOf(32) == LatencyHistogram::bucketOf(33));
+    CHECK(LatencyHistogram::bucketOf(33) != LatencyHistogram::bucketOf(34));
+    CHECK(LatencyHistogram::highestInBucket(LatencyHistogram::bucketOf(1000)) == 1023u);
+    CHECK(LatencyHistogram::bucketOf(~std::uint64_t{0}) == LatencyHistogram::BucketsCount - 1);
+
+    // every value is within 1/16 of its bucket's upper bound
+    for (std::uint64_t v = 1; v < (std::uint64_t{1} << 40); v = v * 3 + 1)
+    {
+        auto hi = LatencyHistogram::highestInBucket(LatencyHistogram::bucketOf(v));
+        auto error = hi - v;
+        CHECK(hi >= v);
+        CHECK(error <= v / 16);
+    }
+}
+
+TEST_CASE("latency histogram percentiles", "[tick_profiler]")
+{
+    LatencyHistogram h;
+    CHECK(h.percentile(50) == 0u);
+
+    for (auto v = 1u; v <= 100; ++v)
+        h.record(v * 1000);
+
+    CHECK(h.count() == 100u);
+    CHECK(h.max() == 100000u);
+    CHECK(h.percentile(50) >= 50000u);
+    CHECK(h.percentile(50) <= 50000u + 50000u / 16);
+    CHECK(h.percentile(99) >= 99000u);
+    CHECK(h.percentile(100) == 100000u);
+
+    h.reset();
+    CHECK(h.count() == 0u);
+    CHECK(h.max() == 0u);
+}
+
+TEST_CASE("tick profiler prints every phase", "[tick_profiler]")
+{
+    TickProfiler p;
+    p.record(TickPhase::Timers, 1500);
+    {
+        TickProfiler::Scope scope{p, TickPhase::Flush};
+    }
+    CHECK(p.histogram(TickPhase::Timers).count() == 1u);
+    CHECK(p.histogram(TickPhase::Flush).count() == 1u);
+
+    std::ostringstream os;
+    p.print(os);
+    auto text = os.str();
+    for (auto i = 0u; i != static_cast<unsigned>(TickPhase::Count); ++i)
+        CHECK(text.find(phaseName(static_cast<TickPhase>(i))) != std::string::npos);
+    CHECK(text.find("1.5") != std::string::npos);
+}
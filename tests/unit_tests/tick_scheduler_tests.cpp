@@ -0,0 +1,56 @@
+#include "TickScheduler.hpp"
+
+#include "catch.hpp"
+
+using std::chrono::milliseconds;
+
+TEST_CASE("tick scheduler keeps deadlines on a fixed grid", "[tick_scheduler]")
+{
+    TickScheduler s{20, 5};
+    TickScheduler::Clock::time_point t0{};
+    s.start(t0);
+
+    CHECK(s.dueTicks(t0) == 1u);
+    CHECK(s.dueTicks(t0 + milliseconds(30)) == 0u);
+
+    // a late wake-up does not shift the following deadlines
+    CHECK(s.dueTicks(t0 + milliseconds(60)) == 1u);
+    CHECK(s.nextTick() == t0 + milliseconds(100));
+    CHECK(s.dueTicks(t0 + milliseconds(100)) == 1u);
+
+    CHECK(s.ticks() == 3u);
+    CHECK(s.overruns() == 1u);
+    CHECK(s.skipped() == 0u);
+}
+
+TEST_CASE("tick scheduler catches up, then drops the backlog", "[tick_scheduler]")
+{
+    TickScheduler s{100, 3};
+    TickScheduler::Clock::time_point t0{};
+    s.start(t0);
+    REQUIRE(s.dueTicks(t0) == 1u);
+
+    // 25 ms late: the ticks due at 10 and 20 ms run back to back
+    CHECK(s.dueTicks(t0 + milliseconds(25)) == 2u);
+    CHECK(s.nextTick() == t0 + milliseconds(30));
+
+    // 100 ms stall: 11 ticks are due, 3 run and the schedule is rebased
+    CHECK(s.dueTicks(t0 + milliseconds(130)) == 3u);
+    CHECK(s.skipped() == 8u);
+    CHECK(s.nextTick() == t0 + milliseconds(140));
+
+    CHECK(s.ticks() == 6u);
+    CHECK(s.overruns() == 2u);
+}
+
+TEST_CASE("tick scheduler sleeps until the deadline", "[tick_scheduler]")
+{
+    TickScheduler s{100, 5};
+    s.start();
+    REQUIRE(s.waitForTicks() >= 1u);
+
+    auto deadline = s.nextTick();
+    CHECK(s.waitForTicks() >= 1u);
+    // only the lower bound: a loaded machine may wake up late
+    CHECK(TickScheduler::Clock::now() >= deadline);
+}
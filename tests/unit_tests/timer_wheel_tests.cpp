@@ -0,0 +1,51 @@
+#include "TimerWheel.hpp"
+
+#include "catch.hpp"
+
+namespace
+{
+    std::vector<ObjectId> expireAt(TimerWheel& wheel, ticks_t now)
+    {
+        std::vector<ObjectId> due;
+        wheel.expire(now, due);
+        return due;
+    }
+}
+
+TEST_CASE("timer wheel expires timers at their deadline", "[timers]")
+{
+    TimerWheel wheel;
+    ObjectId a{1}, b{2}, c{3};
+
+    wheel.add(a, 5, 0);
+    wheel.add(b, 5, 1);
+    wheel.add(c, 7, 0);
+    wheel.mergeStaged();
+
+    CHECK(expireAt(wheel, 4).empty());
+    CHECK(expireAt(wheel, 5).size() == 2);
+    CHECK(expireAt(wheel, 6).empty());
+    CHECK(expireAt(wheel, 7) == std::vector<ObjectId>{c});
+    CHECK(expireAt(wheel, 7).empty());
+}
+
+TEST_CASE("timer wheel keeps timers longer than one turn", "[timers]")
+{
+    TimerWheel wheel;
+    ObjectId a{1};
+
+    wheel.add(a, 10 + TimerWheel::WheelSize, 0);
+    wheel.mergeStaged();
+
+    CHECK(expireAt(wheel, 10).empty());
+    CHECK(expireAt(wheel, 10 + TimerWheel::WheelSize) == std::vector<ObjectId>{a});
+}
+
+TEST_CASE("staged timers are not visible before merge", "[timers]")
+{
+    TimerWheel wheel;
+    ObjectId a{1};
+
+    wheel.add(a, 3, 2);
+    CHECK(expireAt(wheel, 3).empty());
+}
@@ -0,0 +1,52 @@
+#include "WorkerPool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "catch.hpp"
+
+TEST_CASE("worker pool runs job once per thread", "[workers]")
+{
+    WorkerPool pool{MaxThreads};
+    REQUIRE(pool.threadsCount() == MaxThreads);
+
+    for (auto round = 0; round != 1000; ++round)
+    {
+        std::array<std::atomic<int>, MaxThreads> calls{};
+        pool.run([&](ThrdIdx threadIdx)
+        {
+            ++calls[threadIdx];
+        });
+
+        for (auto&& n : calls)
+            REQUIRE(n == 1);
+    }
+}
+
+TEST_CASE("worker pool wakes up parked workers", "[workers]")
+{
+    WorkerPool pool{2};
+
+    std::atomic<int> calls{0};
+    for (auto round = 0; round != 3; ++round)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pool.run([&](ThrdIdx) { ++calls; });
+    }
+
+    REQUIRE(calls == 6);
+}
+
+TEST_CASE("single-threaded worker pool runs on caller thread", "[workers]")
+{
+    WorkerPool pool{1};
+
+    auto callerId = std::this_thread::get_id();
+    pool.run([&](ThrdIdx threadIdx)
+    {
+        REQUIRE(threadIdx == 0);
+        REQUIRE(std::this_thread::get_id() == callerId);
+    });
+}
@@ -0,0 +1,83 @@
+#include "World.hpp"
+
+#include "catch.hpp"
+
+TEST_CASE("world edges block moves out of the world", "[world]")
+{
+    World world{3, 2};
+
+    CHECK_FALSE(world.canMove({0, 0}, Dir::Left));
+    CHECK_FALSE(world.canMove({0, 0}, Dir::Up));
+    CHECK(world.canMove({0, 0}, Dir::Right));
+    CHECK(world.canMove({0, 0}, Dir::Down));
+    CHECK_FALSE(world.canMove({2, 1}, Dir::Right));
+    CHECK_FALSE(world.canMove({2, 1}, Dir::Down));
+}
+
+TEST_CASE("walls block moves into the wall cell only", "[world]")
+{
+    World world{3, 3};
+    world.addWall({1, 1});
+
+    CHECK_FALSE(world.canMove({0, 1}, Dir::Right));
+    CHECK_FALSE(world.canMove({1, 0}, Dir::Down));
+    CHECK_FALSE(world.canMove({2, 1}, Dir::Left));
+    CHECK_FALSE(world.canMove({1, 2}, Dir::Up));
+    CHECK(world.canMove({1, 1}, Dir::Left));
+    CHECK(world.canMove({0, 0}, Dir::Right));
+}
+
+TEST_CASE("neighbour occupancy follows add, lock, move and remove", "[world]")
+{
+    World world{4, 1};
+    ObjectId id{7};
+
+    world.addObject(id, {1, 0});
+    CHECK(world.objectAt({1, 0}) == 7);
+    CHECK_FALSE(world.canMove({0, 0}, Dir::Right));
+    CHECK_FALSE(world.canMove({2, 0}, Dir::Left));
+
+    CHECK(world.lockCell(id, {2, 0}));
+    CHECK(world.objectAt({2, 0}) == World::Handle{World::NoObject});
+    CHECK_FALSE(world.isFree({2, 0}));
+    CHECK_FALSE(world.lockCell(ObjectId{8}, {2, 0}));
+    CHECK_FALSE(world.lockCell(ObjectId{8}, {1, 0}));
+    CHECK_FALSE(world.canMove({3, 0}, Dir::Left));
+
+    world.moveToCell({1, 0}, {2, 0});
+    CHECK(world.objectAt({2, 0}) == 7);
+    CHECK(world.isFree({1, 0}));
+    CHECK(world.canMove({0, 0}, Dir::Right));
+    CHECK_FALSE(world.canMove({1, 0}, Dir::Right));
+
+    world.removeObject({2, 0});
+    CHECK(world.canMove({1, 0}, Dir::Right));
+    CHECK(world.canMove({3, 0}, Dir::Left));
+}
+
+TEST_CASE("world chunks are allocated on write and reclaimed when emptied", "[world]")
+{
+    World world{100000, 100000};
+    CHECK(world.allocatedChunks() == 0);
+    CHECK(world.memoryUsage() < 64u << 20);
+    CHECK_FALSE(world.canMove({99999, 5}, Dir::Right));
+    CHECK(world.isFree({50000, 50000}));
+
+    // the corner cell's neighbours live in two other chunks
+    world.addObject(ObjectId{1}, {64, 64});
+    CHECK(world.allocatedChunks() == 3);
+    CHECK_FALSE(world.canMove({63, 64}, Dir::Right));
+    CHECK_FALSE(world.canMove({64, 63}, Dir::Down));
+
+    // emptied chunks are kept until the end of the tick
+    world.removeObject({64, 64});
+    CHECK(world.allocatedChunks() == 3);
+    world.releaseEmptyChunks();
+    CHECK(world.allocatedChunks() == 0);
+    CHECK(world.canMove({63, 64}, Dir::Right));
+
+    world.addWall({99999, 99999});
+    CHECK(world.allocatedChunks() == 1);
+    CHECK_FALSE(world.canMove({99998, 99999}, Dir::Right));
+    CHECK_FALSE(world.canMove({99998, 99999}, Dir::Down));
+}
@@ -0,0 +1,323 @@
+// Runs the same input on a serial Game and on a parallel one and compares
+// them after every tick: each player's object state, the allocated World
+// chunks and the events each player has received. Reports the first tick
+// where they differ.
+//
+// determinism_check [--threads N] [--journal <path>]
+//                   [--size 256] [--players 6000] [--ticks 300] [--seed 1] [--drain 20]
+//
+// Without --journal a scripted scenario (crowded walkers and casters, players
+// joining and leaving) is recorded into determinism_check.journal first, so a
+// divergence can be replayed with tools/replay.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Replay.hpp"
+
+namespace
+{
+    struct Options
+    {
+        unsigned m_threads{MaxThreads};
+        std::string m_journal;
+        int m_size{256};
+        int m_players{6000};
+        int m_ticks{300};
+        unsigned m_seed{1};
+        int m_drain{20};
+    };
+
+    bool parseArgs(int argc, char* argv[], Options& opt)
+    {
+        for (auto i = 1; i + 1 < argc; i += 2)
+        {
+            std::string arg = argv[i];
+            auto value = std::atoi(argv[i + 1]);
+            if (arg == "--threads") opt.m_threads = static_cast<unsigned>(value);
+            else if (arg == "--journal") opt.m_journal = argv[i + 1];
+            else if (arg == "--size") opt.m_size = value;
+            else if (arg == "--players") opt.m_players = value;
+            else if (arg == "--ticks") opt.m_ticks = value;
+            else if (arg == "--seed") opt.m_seed = static_cast<unsigned>(value);
+            else if (arg == "--drain") opt.m_drain = value;
+            else return false;
+        }
+
+        return argc % 2 == 1 && opt.m_threads >= 2 && opt.m_threads <= MaxThreads
+            && opt.m_size >= 8 && opt.m_players > 0 && opt.m_players <= opt.m_size * opt.m_size / 2
+            && opt.m_ticks > 0 && opt.m_drain >= 0;
+    }
+
+    ActionData scriptedAction(unsigned n, int tick, const Point& home, int size)
+    {
+        ActionData ad{};
+        ad.m_castDest = home;
+        switch (n % 8)
+        {
+        case 0: case 1: case 2: case 3: case 4:
+            ad.m_action = Action::Move;
+            ad.m_moveDir = static_cast<Dir>((n + tick / 6) % DirCount);
+            break;
+
+        case 5: case 6:
+            // Lightning around the spawn point, so casters hit walkers and each other
+            ad.m_action = Action::Cast;
+            ad.m_spell = Spell::Lightning;
+            ad.m_castDest.x = std::min(std::max(home.x + static_cast<int>((n + tick) % 7) - 3, 0), size - 1);
+            ad.m_castDest.y = std::min(std::max(home.y + static_cast<int>((n * 3 + tick) % 7) - 3, 0), size - 1);
+            break;
+
+        default:
+            ad.m_action = Action::Cast;
+            ad.m_spell = Spell::SelfHeal;
+            break;
+        }
+
+        return ad;
+    }
+
+    // plays the scripted scenario on a serial Game and journals its input
+    bool recordScenario(const Options& opt, const std::string& path)
+    {
+        std::mt19937 rng{opt.m_seed};
+        std::bernoulli_distribution isWall{0.08};
+        std::string cells;
+        for (auto n = 0; n != opt.m_size * opt.m_size; ++n)
+            cells += isWall(rng) ? 'W' : '.';
+
+        MapFile map;
+        if (!map.fromText(opt.m_size, cells))
+            return false;
+
+        GameCfg cfg;
+        cfg.worldCX = opt.m_size;
+        cfg.worldCY = opt.m_size;
+        cfg.playerViewRadius = 4;
+        cfg.moveTicks = 2;
+        cfg.castTicks = 2;
+
+        JournalWriter journal;
+        if (!journal.open(path, cfg, &map))
+            return false;
+
+        Game game{cfg};
+        game.m_geodata.loadWalls(map);
+        game.setJournal(&journal);
+
+        ReplayClient::PlayerIds ids;
+        std::vector<std::unique_ptr<ReplayClient>> clients;
+        std::vector<Point> homes;
+        std::uniform_int_distribution<int> randPos{0, opt.m_size - 1};
+        auto join = [&]
+        {
+            Point pt{randPos(rng), randPos(rng)};
+            if (map.isWall(pt) || !game.isCellFree(pt))
+                return;
+
+            clients.push_back(std::make_unique<ReplayClient>(game, ids, static_cast<std::uint32_t>(clients.size())));
+            homes.push_back(pt);
+            game.newPlayer(*clients.back(), pt, "bot");
+        };
+
+        while ((int)clients.size() != opt.m_players)
+            join();
+
+        for (auto tick = 0; tick != opt.m_ticks; ++tick)
+        {
+            for (auto n = 0u; n != clients.size(); ++n)
+            {
+                if ((n + tick) % 97 == 0)
+                    game.enqueueAction(clients[n]->id(), ActionData{Action::Disconnect});
+                else
+                    game.enqueueAction(clients[n]->id(), scriptedAction(n, tick, homes[n], opt.m_size));
+            }
+
+            for (auto n = 0; n != opt.m_players / 100; ++n)
+                join();
+
+            game.tick();
+        }
+
+        journal.close();
+        return true;
+    }
+
+    std::string describe(Game& game, std::uint32_t player)
+    {
+        std::ostringstream os;
+        os << "gone";
+        game.forEachObject([&](const Object& obj)
+        {
+            if (static_cast<const ReplayClient*>(obj.m_eventHandler)->player() != player)
+                return;
+
+            os.str("");
+            os << "pos " << obj.pos().x << "," << obj.pos().y
+                << " state " << static_cast<int>(obj.state())
+                << " dir " << static_cast<int>(obj.moveDir())
+                << " hp " << obj.m_health
+                << " timer " << static_cast<int>(obj.m_timerAction) << "@" << obj.timerDeadline()
+                << (game.cellObject(obj.pos()) == &obj ? "" : " (not in World)");
+        });
+        return os.str();
+    }
+
+    // prints up to 5 players whose digests differ, returns how many differ
+    unsigned reportDiff(const char* what, const std::vector<std::uint64_t>& serial,
+        const std::vector<std::uint64_t>& parallel, Replay& serialRun, Replay& parallelRun)
+    {
+        auto count = 0u;
+        for (auto player = 0u; player != serial.size(); ++player)
+        {
+            if (serial[player] == parallel[player])
+                continue;
+
+            if (++count <= 5)
+            {
+                std::cout << "  " << what << " of player " << player << ":\n"
+                    << "    serial:   " << describe(serialRun.game(), player) << '\n'
+                    << "    parallel: " << describe(parallelRun.game(), player) << '\n';
+            }
+        }
+
+        if (count != 0)
+            std::cout << "  " << count << " players differ in " << what << '\n';
+        return count;
+    }
+
+    // chunk, y, x: sorts cells in the order the World digest visits them
+    using CellKey = std::tuple<std::size_t, int, int>;
+
+    // descriptions of the cells of the allocated chunks
+    std::map<CellKey, std::string> worldCells(Game& game)
+    {
+        std::map<CellKey, std::string> cells;
+        game.forEachWorldCell([&](std::size_t ci, const Point& pt, std::uint32_t flags, const Object* holder)
+        {
+            std::ostringstream os;
+            os << "flags 0x" << std::hex << flags << std::dec;
+            if (holder)
+                os << " player " << static_cast<const ReplayClient*>(holder->m_eventHandler)->player();
+            cells[CellKey{ci, pt.y, pt.x}] = os.str();
+        });
+        return cells;
+    }
+
+    // prints up to 5 World cells that differ, returns how many differ
+    unsigned reportWorldDiff(Game& serialGame, Game& parallelGame)
+    {
+        auto serial = worldCells(serialGame);
+        auto parallel = worldCells(parallelGame);
+        for (auto&& cell : serial)
+            parallel.emplace(cell.first, "chunk not allocated");
+        for (auto&& cell : parallel)
+            serial.emplace(cell.first, "chunk not allocated");
+
+        auto count = 0u;
+        for (auto s = serial.begin(), p = parallel.begin(); s != serial.end(); ++s, ++p)
+        {
+            if (s->second == p->second)
+                continue;
+
+            if (++count <= 5)
+            {
+                std::cout << "  cell " << std::get<2>(s->first) << "," << std::get<1>(s->first)
+                    << " in chunk " << std::get<0>(s->first) << ":\n"
+                    << "    serial:   " << s->second << '\n'
+                    << "    parallel: " << p->second << '\n';
+            }
+        }
+
+        std::cout << "  " << count << " World cells differ\n";
+        return count;
+    }
+
+    void eventDigests(const Replay& replay, std::vector<std::uint64_t>& digests)
+    {
+        digests.resize(replay.playersCount());
+        for (auto player = 0u; player != digests.size(); ++player)
+            digests[player] = replay.client(player).digest();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "usage: determinism_check [--threads 2.." << MaxThreads << "] [--journal <path>]"
+            " [--size N] [--players N] [--ticks N] [--seed N] [--drain N]\n";
+        return 2;
+    }
+
+    auto path = opt.m_journal;
+    if (path.empty())
+    {
+        path = "determinism_check.journal";
+        if (!recordScenario(opt, path))
+        {
+            std::cerr << "cannot record the scenario into " << path << '\n';
+            return 1;
+        }
+    }
+
+    JournalReader serialJournal, parallelJournal;
+    if (!serialJournal.open(path) || !parallelJournal.open(path))
+    {
+        std::cerr << "cannot read " << path << '\n';
+        return 1;
+    }
+
+    GameCfg serialCfg, parallelCfg;
+    parallelCfg.threadsCount = opt.m_threads;
+    Replay serial{serialJournal, serialCfg};
+    Replay parallel{parallelJournal, parallelCfg};
+
+    std::vector<std::uint64_t> serialDigests, parallelDigests;
+    auto drainLeft = opt.m_drain;
+    while (serial.hasRecords() || drainLeft-- > 0)
+    {
+        if (!serial.step() || !parallel.step())
+        {
+            std::cerr << "malformed journal " << path << '\n';
+            return 1;
+        }
+
+        serial.stateDigests(serialDigests);
+        parallel.stateDigests(parallelDigests);
+        auto worldDiverged = serial.worldDigest() != parallel.worldDigest();
+        auto diverged = worldDiverged || serialDigests != parallelDigests;
+        if (diverged)
+        {
+            std::cout << "tick " << serial.ticksCount() << ": world and object state diverged\n";
+            if (worldDiverged)
+                reportWorldDiff(serial.game(), parallel.game());
+            reportDiff("state", serialDigests, parallelDigests, serial, parallel);
+        }
+
+        eventDigests(serial, serialDigests);
+        eventDigests(parallel, parallelDigests);
+        if (serialDigests != parallelDigests)
+        {
+            std::cout << "tick " << serial.ticksCount() << ": event streams diverged\n";
+            reportDiff("events", serialDigests, parallelDigests, serial, parallel);
+            diverged = true;
+        }
+
+        if (diverged)
+            return 1;
+    }
+
+    std::cout << "no divergence between 1 and " << opt.m_threads << " threads in "
+        << serial.ticksCount() << " ticks, " << serial.playersCount() << " players, "
+        << serial.eventsCount() << " events\n";
+}
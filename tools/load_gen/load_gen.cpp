@@ -0,0 +1,499 @@
+// Websocket load generator for a local server (tests/regression_tests --run-server).
+//
+// Opens many connections from one io_service thread and speaks the text
+// commands of client/connection.js. Every client alternates a random "move"
+// with a self-heal "cast": it waits for the server to show it its own
+// see_begin_move or see_cast, then for its see_stop or see_end_cast, and
+// sends the next command --interval ms after that, so it never hits a busy
+// player. With --check 1 the exit status is 1 unless every cast was echoed
+// and at most 1% of all commands went unanswered.
+// Each client is a socket, so thousands of them need a raised `ulimit -n`.
+//
+// load_gen [--host 127.0.0.1] [--port 4080] [--clients 1000] [--ramp 500]
+//          [--duration 30] [--interval 1500] [--timeout 5000] [--check 0]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "TickProfiler.hpp"
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        std::string m_host{"127.0.0.1"};
+        unsigned short m_port{4080};
+        int m_clients{1000};
+        int m_ramp{500};        // new connections per second, 0 opens them all at once
+        int m_duration{30};     // seconds after the last connection was started
+        int m_interval{1500};   // ms between the end of a move or cast and the next command
+        int m_timeout{5000};    // ms to wait for an echo
+        bool m_check{false};
+    };
+
+    bool parseArgs(int argc, char* argv[], Options& opt)
+    {
+        for (auto i = 1; i + 1 < argc; i += 2)
+        {
+            std::string arg = argv[i];
+            auto value = std::atoi(argv[i + 1]);
+            if (arg == "--host") opt.m_host = argv[i + 1];
+            else if (arg == "--port") opt.m_port = static_cast<unsigned short>(value);
+            else if (arg == "--clients") opt.m_clients = value;
+            else if (arg == "--ramp") opt.m_ramp = value;
+            else if (arg == "--duration") opt.m_duration = value;
+            else if (arg == "--interval") opt.m_interval = value;
+            else if (arg == "--timeout") opt.m_timeout = value;
+            else if (arg == "--check") opt.m_check = value != 0;
+            else return false;
+        }
+
+        return argc % 2 == 1 && opt.m_clients > 0 && opt.m_ramp >= 0 && opt.m_duration > 0;
+    }
+
+    std::uint64_t elapsedNs(Clock::time_point since)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+    }
+
+    struct Stats
+    {
+        int m_connected{0};
+        int m_failed{0};
+        int m_closed{0};
+        LatencyHistogram m_connectNs;
+        LatencyHistogram m_echoNs;
+        std::uint64_t m_commands{0};
+        std::uint64_t m_unanswered{0};
+        std::uint64_t m_casts{0};
+        std::uint64_t m_castsUnanswered{0};
+        Clock::time_point m_lastConnected;
+    };
+
+    class Client : public std::enable_shared_from_this<Client>
+    {
+    public:
+        Client(asio::io_service& io, const Options& opt, Stats& stats, unsigned seed)
+            : m_socket{io}, m_timer{io}, m_opt(opt), m_stats(stats), m_rng{seed}
+        {}
+
+        void start(const tcp::endpoint& endpoint)
+        {
+            m_connectStart = Clock::now();
+            auto self = shared_from_this();
+            m_socket.async_connect(endpoint, [this, self](const boost::system::error_code& ec)
+            {
+                if (ec)
+                    return fail();
+
+                boost::system::error_code ignored;
+                m_socket.set_option(tcp::no_delay{true}, ignored);
+                sendHandshake();
+            });
+        }
+
+        void stop()
+        {
+            m_stopped = true;
+            boost::system::error_code ignored;
+            m_timer.cancel(ignored);
+            m_socket.close(ignored);
+        }
+
+        std::uint64_t bytesReceived() const { return m_bytesReceived; }
+        bool isOpen() const { return m_open; }
+
+    private:
+        void sendHandshake()
+        {
+            // the key is the RFC 6455 sample nonce; the accept value is not checked
+            write("GET / HTTP/1.1\r\n"
+                "Host: " + m_opt.m_host + ":" + std::to_string(m_opt.m_port) + "\r\n"
+                "Upgrade: websocket\r\n"
+                "Connection: Upgrade\r\n"
+                "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                "Sec-WebSocket-Version: 13\r\n\r\n");
+
+            auto self = shared_from_this();
+            asio::async_read_until(m_socket, m_handshake, "\r\n\r\n",
+                [this, self](const boost::system::error_code& ec, std::size_t size)
+            {
+                if (ec)
+                    return fail();
+
+                std::string response{asio::buffers_begin(m_handshake.data()), asio::buffers_begin(m_handshake.data()) + size};
+                m_handshake.consume(size);
+                if (response.compare(0, 12, "HTTP/1.1 101") != 0)
+                    return fail();
+
+                m_open = true;
+                ++m_stats.m_connected;
+                m_stats.m_connectNs.record(elapsedNs(m_connectStart));
+                m_stats.m_lastConnected = Clock::now();
+
+                // the handshake read may have pulled in the first frames
+                m_frame.assign(asio::buffers_begin(m_handshake.data()), asio::buffers_end(m_handshake.data()));
+                m_handshake.consume(m_handshake.size());
+                readFrames();
+            });
+        }
+
+        void fail()
+        {
+            if (m_stopped)
+                return;
+
+            if (m_open)
+                ++m_stats.m_closed;
+            else
+                ++m_stats.m_failed;
+
+            stop();
+        }
+
+        // m_frame accumulates raw bytes; whole frames are taken off its front
+        void readFrames()
+        {
+            while (takeFrame())
+                ;
+
+            auto self = shared_from_this();
+            m_socket.async_read_some(asio::buffer(m_readBuf),
+                [this, self](const boost::system::error_code& ec, std::size_t size)
+            {
+                if (ec)
+                    return fail();
+
+                m_bytesReceived += size;
+                m_frame.append(m_readBuf.data(), size);
+                readFrames();
+            });
+        }
+
+        bool takeFrame()
+        {
+            if (m_frame.size() < 2)
+                return false;
+
+            auto bytes = reinterpret_cast<const unsigned char*>(m_frame.data());
+            auto opcode = bytes[0] & 0x0f;
+            auto masked = (bytes[1] & 0x80) != 0;
+            std::uint64_t size = bytes[1] & 0x7f;
+            std::size_t header = 2;
+            if (size == 126 || size == 127)
+            {
+                auto lengthBytes = size == 126 ? 2u : 8u;
+                if (m_frame.size() < header + lengthBytes)
+                    return false;
+
+                size = 0;
+                for (auto i = 0u; i != lengthBytes; ++i)
+                    size = size << 8 | bytes[header + i];
+                header += lengthBytes;
+            }
+
+            auto maskAt = header;
+            if (masked)
+                header += 4;
+
+            if (m_frame.size() < header + size)
+                return false;
+
+            std::string payload = m_frame.substr(header, static_cast<std::size_t>(size));
+            if (masked)
+            {
+                for (auto i = std::size_t{0}; i != payload.size(); ++i)
+                    payload[i] ^= m_frame[maskAt + i % 4];
+            }
+
+            m_frame.erase(0, header + static_cast<std::size_t>(size));
+
+            if (opcode == 0x8)
+                fail();
+            else if (opcode == 0x1 || opcode == 0x0)
+                onText(payload);
+
+            return !m_stopped;
+        }
+
+        void onText(const std::string& payload)
+        {
+            if (m_id.empty())
+            {
+                // {"type":"init","id":N,...}
+                auto pos = payload.find("\"type\":\"init\",\"id\":");
+                if (pos == std::string::npos)
+                    return;
+
+                auto begin = pos + 19;
+                m_id = payload.substr(begin, payload.find_first_of(",}", begin) - begin);
+                m_echo = {};
+                m_finish = {};
+                scheduleCommand(0);
+                return;
+            }
+
+            if (!m_echo.empty() && payload.find(m_echo) != std::string::npos)
+            {
+                m_stats.m_echoNs.record(elapsedNs(m_sentAt));
+                m_echo.clear();
+            }
+
+            // the finish event comes ticks after the echo, never in the same frame
+            if (m_echo.empty() && !m_finish.empty() && payload.find(m_finish) != std::string::npos)
+            {
+                m_finish.clear();
+                scheduleCommand(m_opt.m_interval);
+            }
+        }
+
+        void scheduleCommand(int delayMs)
+        {
+            auto self = shared_from_this();
+            m_timer.expires_from_now(std::chrono::milliseconds(delayMs));
+            m_timer.async_wait([this, self](const boost::system::error_code& ec)
+            {
+                if (!ec && !m_stopped)
+                    sendCommand();
+            });
+        }
+
+        void sendCommand()
+        {
+            std::string type;
+            if (++m_commandsSent % 2 != 0)
+            {
+                std::uniform_int_distribution<int> randDir{0, 3};
+                sendFrame("move " + std::to_string(randDir(m_rng)));
+                m_echo = "\"type\":\"see_begin_move\",\"id\":" + m_id + ",";
+                m_finish = "\"type\":\"see_stop\",\"id\":" + m_id + "}";
+            }
+            else
+            {
+                sendFrame("cast 1 0 0");
+                m_echo = "\"type\":\"see_cast\",\"id\":" + m_id + ",";
+                m_finish = "\"type\":\"see_end_cast\",\"id\":" + m_id + "}";
+                ++m_stats.m_casts;
+            }
+
+            m_sentAt = Clock::now();
+            ++m_stats.m_commands;
+
+            // a blocked move gets no echo; a lost finish event only delays the next command
+            auto self = shared_from_this();
+            m_timer.expires_from_now(std::chrono::milliseconds(m_opt.m_timeout));
+            m_timer.async_wait([this, self](const boost::system::error_code& ec)
+            {
+                if (ec || m_stopped)
+                    return;
+
+                if (!m_echo.empty())
+                {
+                    ++m_stats.m_unanswered;
+                    if (m_commandsSent % 2 == 0)
+                        ++m_stats.m_castsUnanswered;
+                }
+
+                m_echo.clear();
+                m_finish.clear();
+                sendCommand();
+            });
+        }
+
+        void sendFrame(const std::string& text)
+        {
+            std::uniform_int_distribution<unsigned> randByte{0, 255};
+            unsigned char mask[4];
+            for (auto&& b : mask)
+                b = static_cast<unsigned char>(randByte(m_rng));
+
+            std::string frame;
+            frame += static_cast<char>(0x81);
+            if (text.size() < 126)
+            {
+                frame += static_cast<char>(0x80 | text.size());
+            }
+            else
+            {
+                frame += static_cast<char>(0x80 | 126);
+                frame += static_cast<char>(text.size() >> 8);
+                frame += static_cast<char>(text.size() & 0xff);
+            }
+
+            frame.append(reinterpret_cast<const char*>(mask), 4);
+            for (auto i = std::size_t{0}; i != text.size(); ++i)
+                frame += static_cast<char>(text[i] ^ mask[i % 4]);
+
+            write(std::move(frame));
+        }
+
+        void write(std::string data)
+        {
+            m_writeQueue.push_back(std::move(data));
+            if (m_writeQueue.size() == 1)
+                writeNext();
+        }
+
+        void writeNext()
+        {
+            auto self = shared_from_this();
+            asio::async_write(m_socket, asio::buffer(m_writeQueue.front()),
+                [this, self](const boost::system::error_code& ec, std::size_t)
+            {
+                if (ec)
+                    return fail();
+
+                m_writeQueue.pop_front();
+                if (!m_writeQueue.empty())
+                    writeNext();
+            });
+        }
+
+        tcp::socket m_socket;
+        asio::steady_timer m_timer;
+        const Options& m_opt;
+        Stats& m_stats;
+        std::mt19937 m_rng;
+
+        bool m_open{false};
+        bool m_stopped{false};
+        Clock::time_point m_connectStart;
+        asio::streambuf m_handshake;
+        std::array<char, 16 * 1024> m_readBuf;
+        std::string m_frame;
+        std::deque<std::string> m_writeQueue;
+        std::uint64_t m_bytesReceived{0};
+
+        std::string m_id;
+        std::string m_echo;
+        std::string m_finish;
+        Clock::time_point m_sentAt;
+        unsigned m_commandsSent{0};
+    };
+
+    void printLatency(const char* title, const LatencyHistogram& h)
+    {
+        std::cout << title << ": " << h.count() << " samples, p50 " << h.percentile(50) / 1e6
+            << " ms, p99 " << h.percentile(99) / 1e6 << " ms, max " << h.max() / 1e6 << " ms\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "usage: load_gen [--host IP] [--port N] [--clients N] [--ramp N]"
+            " [--duration S] [--interval MS] [--timeout MS] [--check 0|1]\n";
+        return 2;
+    }
+
+    asio::io_service io;
+    boost::system::error_code ec;
+    tcp::endpoint endpoint{asio::ip::address::from_string(opt.m_host, ec), opt.m_port};
+    if (ec)
+    {
+        std::cerr << "invalid address " << opt.m_host << '\n';
+        return 1;
+    }
+
+    Stats stats;
+    std::vector<std::shared_ptr<Client>> clients;
+    auto start = Clock::now();
+
+    // starts connections in batches of 10 to follow --ramp
+    asio::steady_timer rampTimer{io};
+    std::function<void()> startBatch = [&]
+    {
+        auto batch = opt.m_ramp == 0 ? opt.m_clients : 10;
+        for (auto n = 0; n != batch && (int)clients.size() != opt.m_clients; ++n)
+        {
+            clients.push_back(std::make_shared<Client>(io, opt, stats, static_cast<unsigned>(clients.size())));
+            clients.back()->start(endpoint);
+        }
+
+        if ((int)clients.size() != opt.m_clients)
+        {
+            rampTimer.expires_from_now(std::chrono::microseconds(10 * 1000000 / opt.m_ramp));
+            rampTimer.async_wait([&](const boost::system::error_code&) { startBatch(); });
+        }
+    };
+
+    // reports once a second, stops after --duration seconds past the last connection
+    asio::steady_timer reportTimer{io};
+    auto secondsLeft = opt.m_duration;
+    std::function<void()> report = [&]
+    {
+        reportTimer.expires_from_now(std::chrono::seconds(1));
+        reportTimer.async_wait([&](const boost::system::error_code&)
+        {
+            std::cout << "connected " << stats.m_connected << "/" << opt.m_clients
+                << ", failed " << stats.m_failed << ", closed " << stats.m_closed
+                << ", commands " << stats.m_commands << ", echoes " << stats.m_echoNs.count() << '\n';
+
+            if ((int)clients.size() == opt.m_clients && --secondsLeft == 0)
+            {
+                for (auto&& c : clients)
+                    c->stop();
+                return;
+            }
+
+            report();
+        });
+    };
+
+    startBatch();
+    report();
+    io.run();
+
+    std::uint64_t totalBytes = 0, minBytes = ~std::uint64_t{0}, maxBytes = 0;
+    auto open = 0;
+    for (auto&& c : clients)
+    {
+        if (!c->isOpen())
+            continue;
+
+        ++open;
+        totalBytes += c->bytesReceived();
+        minBytes = std::min(minBytes, c->bytesReceived());
+        maxBytes = std::max(maxBytes, c->bytesReceived());
+    }
+
+    auto connectSeconds = std::chrono::duration<double>(stats.m_lastConnected - start).count();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\nconnections: " << stats.m_connected << " ok, " << stats.m_failed << " failed, "
+        << stats.m_closed << " closed by server\n";
+    if (stats.m_connected != 0)
+        std::cout << "connect rate: " << stats.m_connected / connectSeconds << " per second\n";
+    printLatency("connect", stats.m_connectNs);
+    printLatency("input to echo", stats.m_echoNs);
+    std::cout << "commands: " << stats.m_commands << ", unanswered " << stats.m_unanswered
+        << " (casts " << stats.m_casts << ", unanswered " << stats.m_castsUnanswered << ")\n";
+    if (open != 0)
+        std::cout << "bytes received per client: avg " << totalBytes / open
+            << ", min " << minBytes << ", max " << maxBytes << '\n';
+
+    if (opt.m_check && (stats.m_casts == 0 || stats.m_castsUnanswered != 0
+        || stats.m_unanswered * 100 > stats.m_commands))
+    {
+        std::cout << "check failed: every cast must be echoed and at most 1% of commands unanswered\n";
+        return 1;
+    }
+}
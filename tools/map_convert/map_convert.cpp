@@ -0,0 +1,66 @@
+// Converts a text world map into the binary format loaded by MapFile.
+//
+// The text map has one row per line: '.' is an empty cell, 'W' is a wall,
+// '?' is a spawn point. All rows must have the same length.
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "MapFile.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: map_convert <input.txt> <output.map>\n";
+        return 2;
+    }
+
+    std::ifstream input{argv[1]};
+    if (!input)
+    {
+        std::cerr << "cannot open " << argv[1] << '\n';
+        return 1;
+    }
+
+    std::string cells, row;
+    auto cx = 0;
+    for (auto line = 1; std::getline(input, row); ++line)
+    {
+        if (!row.empty() && row.back() == '\r')
+            row.pop_back();
+
+        if (row.empty())
+            continue;
+
+        if (cx == 0)
+            cx = static_cast<int>(row.size());
+
+        if (static_cast<int>(row.size()) != cx)
+        {
+            std::cerr << argv[1] << ':' << line << ": row length " << row.size() << ", expected " << cx << '\n';
+            return 1;
+        }
+
+        cells += row;
+    }
+
+    std::vector<std::uint64_t> image;
+    if (!MapFile::encodeTextMap(cx, cells, image))
+    {
+        std::cerr << argv[1] << ": empty map or unknown cell type\n";
+        return 1;
+    }
+
+    std::ofstream output{argv[2], std::ios::binary};
+    output.write(reinterpret_cast<const char*>(image.data()), image.size() * sizeof(image[0]));
+    if (!output)
+    {
+        std::cerr << "cannot write " << argv[2] << '\n';
+        return 1;
+    }
+
+    std::cout << argv[2] << ": " << cx << 'x' << cells.size() / cx << ", "
+        << image.size() * sizeof(image[0]) << " bytes\n";
+}
@@ -0,0 +1,71 @@
+// Replays a journal recorded with `regression_tests --journal <path> --run-server`
+// against a fresh Game, without networking, as fast as it can tick.
+//
+// replay <journal> [--threads N] [--repeat N] [--drain N]
+//
+// Prints the tick rate, tick latencies and a digest of all events the players
+// received; equal digests mean the runs produced the same events.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "Replay.hpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc % 2 != 0)
+    {
+        std::cerr << "usage: replay <journal> [--threads N] [--repeat N] [--drain N]\n";
+        return 2;
+    }
+
+    GameCfg cfg;
+    auto repeat = 1;
+    auto drainTicks = 100u;
+    for (auto i = 2; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        auto value = std::atoi(argv[i + 1]);
+        if (arg == "--threads" && value >= 1 && value <= MaxThreads) cfg.threadsCount = static_cast<unsigned>(value);
+        else if (arg == "--repeat" && value >= 1) repeat = value;
+        else if (arg == "--drain" && value >= 0) drainTicks = static_cast<unsigned>(value);
+        else
+        {
+            std::cerr << "invalid option " << arg << ' ' << argv[i + 1] << '\n';
+            return 2;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (auto run = 0; run != repeat; ++run)
+    {
+        JournalReader journal;
+        if (!journal.open(argv[1]))
+        {
+            std::cerr << "cannot read " << argv[1] << '\n';
+            return 1;
+        }
+
+        Replay replay{journal, cfg};
+        auto start = TickProfiler::Clock::now();
+        auto ok = replay.run(drainTicks);
+        auto seconds = std::chrono::duration<double>(TickProfiler::Clock::now() - start).count();
+        if (!ok)
+        {
+            std::cerr << "malformed journal " << argv[1] << '\n';
+            return 1;
+        }
+
+        auto& h = replay.tickNs();
+        std::cout << "players " << replay.playersCount()
+            << ", ticks " << replay.ticksCount()
+            << ", " << replay.ticksCount() / seconds << " ticks/s"
+            << ", tick p50 " << h.percentile(50) / 1000.0 << " us"
+            << ", p99 " << h.percentile(99) / 1000.0 << " us"
+            << ", max " << h.max() / 1000.0 << " us"
+            << ", events " << replay.eventsCount()
+            << ", digest " << std::hex << replay.digest() << std::dec << '\n';
+    }
+}